@@ -11,6 +11,8 @@ import os
 import sys
 import struct
 import caffe
+from caffe.proto import caffe_pb2
+from google.protobuf import text_format
 import time
 import numpy as np
 import random
@@ -36,15 +38,20 @@ if prototxt == "undef" or caffemodel == "undef" :
 print("Using prototxt: {}, caffemodel: {}".format(prototxt, caffemodel))
 
 # Functions to Reshape and Save given Weight/Bias Blob
-def append_filters(weights, blob):
+# (grouped conv: blob is [ch_out][ch_in/groups][k][k], FPGA expects
+#  [ch_in][ch_out/groups][k][k] with only the filters of each ci's group)
+def append_filters(weights, blob, groups=1):
     ch_out = blob.shape[0]
-    ch_in = blob.shape[1]
+    ch_in_per_group = blob.shape[1]
+    ch_out_per_group = ch_out / groups
+    ch_in = ch_in_per_group * groups
     kernel = blob.shape[2]
     for ci in range(ch_in):
-        for co in range(ch_out):
+        group = ci / ch_in_per_group
+        for co in range(group*ch_out_per_group, (group+1)*ch_out_per_group):
             for ky in range(kernel):  
                 for kx in range(kernel):
-                    weights.append(blob.data[co][ci][kx][ky]) ### BEWARE: X, Y MIGHT BE SWITCHED!
+                    weights.append(blob.data[co][ci % ch_in_per_group][kx][ky]) ### BEWARE: X, Y MIGHT BE SWITCHED!
 def append_bias(weights, blob):
     ch_out = blob.shape[0]
     for co in range(ch_out):
@@ -60,6 +67,12 @@ start_time = time.clock()
 caffe.set_mode_cpu() # use CPU for more compatibility
 net = caffe.Net(prototxt, caffemodel, caffe.TEST);
 
+# Parse prototxt for parameters not exposed by pycaffe (conv groups)
+netparam = caffe_pb2.NetParameter()
+with open(prototxt) as f:
+    text_format.Merge(f.read(), netparam)
+conv_groups = dict((l.name, l.convolution_param.group) for l in netparam.layer)
+
 # Initialize Helper Variables
 weights = []
 layer_count = 0
@@ -71,6 +84,7 @@ max_active_area = 0
 max_image_cache = 0
 max_dimension = 0
 max_channels = 0
+max_pool_cache = 1  # fused max pooling: 2 lines of pooled pixels (at least 1)
 total_inputs = 0    # total num. elements read from / written to memory
 total_outputs = 0
 total_dram_IO = 0   # total num. DRAM accesses (input + output) (data + weights)
@@ -143,7 +157,8 @@ for id,layer_name in enumerate(layer_names):
             else:
                 pad = 0
                 
-            ch_in = params[0].shape[1]
+            groups = conv_groups.get(layer_name, 1)
+            ch_in = params[0].shape[1] * groups
             
             # Determine memory accesses for CONV layer:
             # Normally, increment output address 
@@ -171,14 +186,15 @@ for id,layer_name in enumerate(layer_names):
                 'stride': stride,
                 'is_expand_layer': is_expand_layer,
                 'update_mem_address': update_mem_address,
-                'pool_type': "POOL_NONE"
+                'pool_type': "POOL_NONE",
+                'groups': groups
             })
             
             # Count Number of Weights:
-            weights_count += ch_in*ch_out*kernel*kernel + ch_out
+            weights_count += ch_in*(ch_out/groups)*kernel*kernel + ch_out
                          
             # Append Weights and Biases to List
-            append_filters(weights, params[0])
+            append_filters(weights, params[0], groups)
             append_bias(weights, params[1])
             
             #print("In Layer {}, using weights: {} and bias: {}".format(id, params[0].data.flatten()[0], params[1].data.flatten()[0]))
@@ -187,7 +203,7 @@ for id,layer_name in enumerate(layer_names):
             layer_count = layer_count + 1
             
             # Update Maximum necessary Cache sizes:
-            weights_size = ch_in*ch_out*kernel*kernel + ch_out
+            weights_size = ch_in*(ch_out/groups)*kernel*kernel + ch_out
             input_size = ch_in*width_in*height_in
             output_size = ch_out*width_out*height_out
             pixels_per_row = ch_in*width_in;
@@ -232,13 +248,17 @@ for id,layer_name in enumerate(layer_names):
                 convlayer['pool_type'] = pool_type
                 layers.append(convlayer)
 
+            # Update necessary Pooling Cache size (2 lines of pooled pixels)
+            if pool_type in ("POOL_3x3S2", "POOL_2x2S2"):
+                max_pool_cache = max(max_pool_cache, 2*width_out*ch_in)
+
 # Generate Network Description:
 n = ""
 for layer in layers:
     t  = "  addLayer(net, layer_t("
     t += "\"{name:<6s}\", {type:s}, {width:3d}, {height:3d}, {ch_in:4d},"
     t += "{ch_out:4d},{kernel:2d},{pad:2d},{stride:2d}), {is_expand_layer:d},  "
-    t += "{update_mem_address:d}, {pool_type:s});\n"
+    t += "{update_mem_address:d}, {pool_type:s}, {groups:d});\n"
     n += t.format(**layer);
 
 # Add Header and Footer
@@ -262,6 +282,7 @@ const int MAX_INPUT_PER_LAYER = {};
 const int MAX_NUM_CHOUT = {};
 const int MAX_DIMENSION = {};
 const int MAX_CHANNELS = {};
+const int MAX_POOL_CACHE_SIZE = {};
 
 const int TOTAL_NUM_WEIGHTS = {};
 const int TOTAL_NUM_INPUTS = {};
@@ -282,6 +303,7 @@ network_t *get_network_config();
 #endif
 """.format(header, layer_count, weights_cache_needed,image_cache_needed,
            max_image_cache, max_num_chout, max_dimension, max_channels,
+           max_pool_cache,
            weights_count, total_inputs, total_outputs, total_dram_IO )
           
 # double braces in function definition needed because of python's str.format()!
@@ -290,7 +312,7 @@ cfile = """{0}
 network_t *get_network_config() {{
   network_t *net = new network_t({1:d}, {2:d});\n
   //                                                                            UPD
-  // Layer Attributes: ( NAME   , TYPE      ,   W,   H,   CI,  CO, K, P, S) EXP MEM POOL Type
+  // Layer Attributes: ( NAME   , TYPE      ,   W,   H,   CI,  CO, K, P, S) EXP MEM POOL Type  GROUPS
 {3}
   net->num_weights = {4};
   const char* filename = "weights.bin";
@@ -309,6 +331,32 @@ with open("network.cpp", "w") as f:
 floatstruct = struct.pack('f'*len(weights), *weights)
 with open("weights.bin", "wb") as f:
     f.write(floatstruct)
+
+# Write single-file model container (see model_file.hpp):
+# header, layer table (arguments of addConcatLayer), page-aligned weights
+MODEL_FILE_MAGIC = "SQZMODEL"
+MODEL_FILE_VERSION = 2
+MODEL_FILE_ALIGNMENT = 4096
+POOL_TYPES = ["POOL_NONE", "POOL_GLOBAL", "POOL_2x2S2", "POOL_3x3S2"]
+header_size = struct.calcsize('<8s8I')
+layer_size = struct.calcsize('<8s15i')
+table_end = header_size + layer_count*layer_size
+weights_offset = (table_end + MODEL_FILE_ALIGNMENT - 1) / MODEL_FILE_ALIGNMENT * MODEL_FILE_ALIGNMENT
+model = struct.pack('<8s8I', MODEL_FILE_MAGIC, MODEL_FILE_VERSION, header_size,
+                    layer_count, layer_size, header_size, len(weights),
+                    weights_offset, 0)
+for layer in layers:
+    concat_channels = layer['ch_out'] * (2 if layer['is_expand_layer'] else 1)
+    model += struct.pack('<8s15i', layer['name'].strip(), 0, layer['width'],
+                         layer['height'], layer['ch_in'], layer['ch_out'],
+                         layer['kernel'], layer['pad'], layer['stride'],
+                         concat_channels, layer['update_mem_address'],
+                         POOL_TYPES.index(layer['pool_type']), layer['groups'],
+                         -1, -1, -1)
+model += '\0' * (weights_offset - table_end)
+with open("network.model", "wb") as f:
+    f.write(model)
+    f.write(floatstruct)
     
 end_time = time.clock()
 time_taken = end_time - start_time
@@ -321,6 +369,7 @@ print(cfile)
 print("REPORT:\n-----------")
 print("%d-layer Network saved to <network.{hpp,cpp}>" % layer_count)
 print("%d Weights saved to <weights.bin>" % len(weights))
+print("Network + Weights saved to <network.model>")
 
 print("Total Operations took %d seconds on CPU." % time_taken)
 
@@ -9,6 +9,45 @@
 #ifndef _NETWORK_H_
 #define _NETWORK_H_
 
+#include "netdesc.hpp"  // layer_desc_t, compile-time checks
+
+// Layer Table (host only): host builds check all constants below against
+// it at compile time (netconfig.hpp, netdesc.hpp)
+// (EXP: expand layer, UPD: new output feature map, see layer_desc_t)
+#if NET_DESC_TABLE
+// clang-format off
+constexpr layer_desc_t NET_LAYERS[] = {
+  // NAME   , TYPE      ,   W,   H,   CI,  CO, K, P, S,EXP,UPD, POOL Type
+  {"cnv1  ", LAYER_CONV, 256, 256,    3,  64, 3, 1, 2, 0, 1, POOL_NONE},
+  {"f2/s1 ", LAYER_CONV, 128, 128,   64,  16, 3, 1, 2, 0, 1, POOL_NONE},
+  {"f2/e1 ", LAYER_CONV,  64,  64,   16,  64, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f2/e3 ", LAYER_CONV,  64,  64,   16,  64, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f3/s1 ", LAYER_CONV,  64,  64,  128,  16, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f3/e1 ", LAYER_CONV,  64,  64,   16,  64, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f3/e3 ", LAYER_CONV,  64,  64,   16,  64, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f4/s1 ", LAYER_CONV,  64,  64,  128,  32, 3, 1, 2, 0, 1, POOL_NONE},
+  {"f4/e1 ", LAYER_CONV,  32,  32,   32, 128, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f4/e3 ", LAYER_CONV,  32,  32,   32, 128, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f5/s1 ", LAYER_CONV,  32,  32,  256,  32, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f5/e1 ", LAYER_CONV,  32,  32,   32, 128, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f5/e3 ", LAYER_CONV,  32,  32,   32, 128, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f6/s1 ", LAYER_CONV,  32,  32,  256,  64, 3, 1, 2, 0, 1, POOL_NONE},
+  {"f6/e1 ", LAYER_CONV,  16,  16,   64, 256, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f6/e3 ", LAYER_CONV,  16,  16,   64, 256, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f7/s1 ", LAYER_CONV,  16,  16,  512,  64, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f7/e1 ", LAYER_CONV,  16,  16,   64, 256, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f7/e3 ", LAYER_CONV,  16,  16,   64, 256, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f8/s1 ", LAYER_CONV,  16,  16,  512,  64, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f8/e1 ", LAYER_CONV,  16,  16,   64, 256, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f8/e3 ", LAYER_CONV,  16,  16,   64, 256, 3, 1, 1, 1, 0, POOL_NONE},
+  {"f9/s1 ", LAYER_CONV,  16,  16,  512,  64, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f9/e1 ", LAYER_CONV,  16,  16,   64, 256, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f9/e3 ", LAYER_CONV,  16,  16,   64, 256, 3, 1, 1, 1, 0, POOL_NONE},
+  {"cnv10 ", LAYER_CONV,  16,  16,  512,1000, 1, 0, 1, 0, 1, POOL_GLOBAL},
+};
+// clang-format on
+#endif
+
 // Size Limits for this Network
 const int MAX_NUM_LAYERS = 26;
 const int MAX_WEIGHTS_PER_LAYER = 513000;
@@ -17,14 +56,25 @@ const int MAX_INPUT_PER_LAYER = 1048576;
 const int MAX_NUM_CHOUT = 1000;
 const int MAX_DIMENSION = 256;
 const int MAX_CHANNELS = 1000;
+const int MAX_POOL_CACHE_SIZE = 1;
 
 const int TOTAL_NUM_WEIGHTS = 1577800;
 const int TOTAL_NUM_INPUTS = 3866624;
 const int TOTAL_NUM_OUTPUTS = 3663872;
 const int TOTAL_DRAM_IO = 9108296;
+const int DRAM_DEPTH = 5510844;
+
+// Loop Trip Counts (LOOP_TRIPCOUNT pragmas: min / max / avg over all layers)
+const int MIN_DIMENSION = 16;
+const int AVG_DIMENSION = 44;
+const int MIN_CHANNELS_IN = 3;
+const int MAX_CHANNELS_IN = 512;
+const int AVG_CHANNELS_IN = 138;
+const int MIN_NUM_CHOUT = 16;
+const int AVG_NUM_CHOUT = 163;
+const int NET_NUM_CLASSES = 1000;
 
 const float TEST_RESULT_EXPECTED = 92.3337;
-const int DRAM_DEPTH = 7863424;
 
 // Mean Pixel for ImageNet Data
 const float MEAN_R = 104;
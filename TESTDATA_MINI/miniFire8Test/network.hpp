@@ -9,6 +9,24 @@
 #ifndef _NETWORK_H_
 #define _NETWORK_H_
 
+#include "netdesc.hpp"  // layer_desc_t, compile-time checks
+
+// Layer Table (host only): host builds check all constants below against
+// it at compile time (netconfig.hpp, netdesc.hpp)
+// (EXP: expand layer, UPD: new output feature map, see layer_desc_t)
+#if NET_DESC_TABLE
+// clang-format off
+constexpr layer_desc_t NET_LAYERS[] = {
+  // NAME   , TYPE      ,   W,   H,   CI,  CO, K, P, S,EXP,UPD, POOL Type
+  {"cnv1  ", LAYER_CONV,   8,   8,    3,   8, 3, 1, 2, 0, 1, POOL_NONE},
+  {"f/s1  ", LAYER_CONV,   4,   4,    8,   2, 1, 0, 1, 0, 1, POOL_NONE},
+  {"f/e1  ", LAYER_CONV,   4,   4,    2,   4, 1, 0, 1, 1, 1, POOL_NONE},
+  {"f/e3  ", LAYER_CONV,   4,   4,    2,   4, 3, 1, 1, 1, 0, POOL_NONE},
+  {"cnv10 ", LAYER_CONV,   4,   4,    8,  10, 1, 0, 1, 0, 1, POOL_GLOBAL},
+};
+// clang-format on
+#endif
+
 // Size Limits for this Network
 const int MAX_NUM_LAYERS = 5;
 const int MAX_WEIGHTS_PER_LAYER = 224;
@@ -17,12 +35,23 @@ const int MAX_INPUT_PER_LAYER = 192;
 const int MAX_NUM_CHOUT = 10;
 const int MAX_DIMENSION = 8;
 const int MAX_CHANNELS = 10;
+const int MAX_POOL_CACHE_SIZE = 1;
 
 const int TOTAL_NUM_WEIGHTS = 420;
 const int TOTAL_NUM_INPUTS = 512;
 const int TOTAL_NUM_OUTPUTS = 448;
 const int TOTAL_DRAM_IO = 1380;
+const int DRAM_DEPTH = 1550;
 
+// Loop Trip Counts (LOOP_TRIPCOUNT pragmas: min / max / avg over all layers)
+const int MIN_DIMENSION = 4;
+const int AVG_DIMENSION = 5;
+const int MIN_CHANNELS_IN = 2;
+const int MAX_CHANNELS_IN = 8;
+const int AVG_CHANNELS_IN = 5;
+const int MIN_NUM_CHOUT = 2;
+const int AVG_NUM_CHOUT = 6;
+const int NET_NUM_CLASSES = 10;
 
 // Mean Pixel for ImageNet Data
 const float MEAN_R = 104;
@@ -11,19 +11,44 @@ add_files processing_element.hpp
 add_files processing_element.cpp
 add_files output_cache.hpp
 add_files output_cache.cpp
+add_files pooling_cache.hpp
+add_files pooling_cache.cpp
 add_files network.hpp
 add_files netconfig.hpp
+add_files netdesc.hpp
+add_files native_int.hpp
 add_files memory_controller.hpp
 add_files memory_controller.cpp
+add_files perf_counters.hpp
+add_files perf_counters.cpp
+add_files dram_trace.hpp
+add_files log_trace.hpp
+add_files layer_profile.hpp
 add_files image_cache.hpp
 add_files image_cache.cpp
 add_files fpga_top.hpp
 add_files fpga_top.cpp
+add_files -tb autotune.cpp
+add_files -tb autotune.hpp
 add_files -tb cpu_top.cpp
 add_files -tb cpu_top.hpp
+add_files -tb cpu_engine.cpp
+add_files -tb cpu_engine.hpp
+add_files -tb dram_trace.cpp
 add_files -tb indata.bin
+add_files -tb layer_profile.cpp
+add_files -tb log_trace.cpp
+add_files -tb model_file.cpp
+add_files -tb model_file.hpp
 add_files -tb netconfig.cpp
+add_files -tb perf_model.cpp
+add_files -tb perf_model.hpp
+add_files -tb regression.cpp
+add_files -tb regression.hpp
+add_files -tb runtime.cpp
+add_files -tb runtime.hpp
 add_files -tb netconfig.hpp
+add_files -tb netdesc.hpp
 add_files -tb network.cpp
 add_files -tb network.hpp
 add_files -tb unittests.cpp
@@ -0,0 +1,261 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  autotune.cpp
+//
+//  Architecture Autotuner (Performance Model + Resource Estimate per Config)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "autotune.hpp"
+#include <algorithm>
+#include <cmath>
+
+// ======================
+// = Resource Estimates =
+// ======================
+// Single-precision operators as instantiated by Vivado HLS on 7-series
+// (fmul / fadd with full DSP usage), per PE: 9 multipliers + 9 adders
+// (macc2d accumulation chain)
+const int DSP_PER_FMUL = 3;
+const int DSP_PER_FADD = 2;
+const int LUT_PER_FMUL = 90;
+const int LUT_PER_FADD = 240;
+// Fixed: postprocessing adders (bias, bypass, global pooling), index
+// arithmetic, AXI master + AXI-Lite slave, layer config, control
+const int DSP_FIXED = 3 * DSP_PER_FADD + 10;
+const int LUT_FIXED = 25000;
+const int BRAM18K_FIXED = 4;
+
+tune_budget_t xc7z045Budget(double utilization) {
+  tune_budget_t budget;
+  budget.dsp = XC7Z045_DSP * utilization;
+  budget.bram18k = XC7Z045_BRAM18K * utilization;
+  budget.lut = XC7Z045_LUT * utilization;
+  return budget;
+}
+
+// BRAM18K blocks for one memory of DEPTH words x WIDTH bits (best aspect
+// ratio of the primitive, small memories go to LUTRAM / registers)
+static int bram18kBlocks(double depth, int width) {
+  if (depth * width <= 1024) return 0;
+  const int modes[][2] = {{16384, 1}, {8192, 2}, {4096, 4}, {2048, 9},
+                          {1024, 18}, {512, 36}};
+  double best = 1e18;
+  for (int m = 0; m < 6; m++)
+    best = std::min(best, std::ceil(depth / modes[m][0]) *
+                              std::ceil((double)width / modes[m][1]));
+  return best;
+}
+
+// ================
+// = Size Limits  =
+// ================
+
+tune_limits_t networkLimits(network_t *net, int img_cache_lines) {
+  tune_limits_t lim = {net->num_layers, 0, 0, 0, 0, 0, 0, 1};
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    int width = layer->width, height = layer->height;
+    int ch_in = layer->channels_in, ch_out = layer->channels_out;
+    int num_weights = (ch_out / layer->groups) * ch_in * layer->kernel *
+                          layer->kernel +
+                      ch_out;
+    int width_out = width / (int)layer->stride;
+    bool max_pool = (layer->pool == POOL_2x2S2 || layer->pool == POOL_3x3S2);
+    lim.weights_per_layer = std::max(lim.weights_per_layer, num_weights);
+    lim.image_cache_size =
+        std::max(lim.image_cache_size, img_cache_lines * width * ch_in);
+    lim.input_per_layer =
+        std::max(lim.input_per_layer, width * height * ch_in);
+    lim.num_chout = std::max(lim.num_chout, ch_out);
+    lim.dimension = std::max(lim.dimension, std::max(width, height));
+    lim.channels = std::max(lim.channels, std::max(ch_in, ch_out));
+    lim.channels = std::max(lim.channels, (int)layer->out_pixel_stride);
+    if (max_pool)
+      lim.pool_cache_size =
+          std::max(lim.pool_cache_size,
+                   2 * pooled_dimension(width_out, layer->pool) * ch_out);
+  }
+  return lim;
+}
+
+// =========================
+// = Evaluate one Config   =
+// =========================
+
+// Initiation interval of L_CH_OUT: the N_PE unrolled iterations fetch
+// N_PE x 9 consecutive weights (3x3), or N_PE (1x1: getNineWeights<1>
+// reads the center weight only), from 2 BRAM ports of WCACHE_RESHAPE words
+// each (unaligned start: one word more)
+static int choutII(const tune_config_t &config, int kernel) {
+  int span = (kernel == 3) ? 9 * config.n_pe : config.n_pe;
+  int r = config.wcache_reshape;
+  int words = (span + r - 1 + r - 1) / r;
+  return std::max(1, (words + 1) / 2);
+}
+
+tune_result_t evaluateConfig(network_t *net, const tune_config_t &config,
+                             const tune_budget_t &budget) {
+  tune_result_t res;
+  res.config = config;
+  res.limits = networkLimits(net, config.img_cache_lines);
+  const tune_limits_t &lim = res.limits;
+
+  // Resources
+  res.dsp = config.n_pe * 9 * (DSP_PER_FMUL + DSP_PER_FADD) + DSP_FIXED;
+  res.lut = config.n_pe * 9 * (LUT_PER_FMUL + LUT_PER_FADD) + LUT_FIXED;
+  int r = config.wcache_reshape;
+  res.bram18k =
+      bram18kBlocks(std::ceil((double)lim.weights_per_layer / r), 32 * r) +
+      bram18kBlocks(lim.image_cache_size, 32) +
+      3 * bram18kBlocks(std::ceil((double)lim.num_chout / config.n_pe),
+                        32 * config.n_pe) +  // OCache, GPoolCache, BCache
+      bram18kBlocks(lim.pool_cache_size, 32) + BRAM18K_FIXED;
+  res.fits = (res.dsp <= budget.dsp && res.bram18k <= budget.bram18k &&
+              res.lut <= budget.lut);
+
+  // Performance
+  perf_arch_t arch = defaultPerfArch();
+  arch.n_pe = config.n_pe;
+  arch.img_cache_lines = config.img_cache_lines;
+  res.cycles = 0;
+  for (int i = 0; i < net->num_layers; i++) {
+    arch.chout_ii = choutII(config, net->layers[i].kernel);
+    res.cycles += estimateLayerPerformance(&net->layers[i], arch).cycles;
+  }
+  res.images_per_s = arch.clock_mhz * 1e6 / res.cycles;
+  return res;
+}
+
+// ==========================
+// = Search all Configs     =
+// ==========================
+
+static bool betterResult(const tune_result_t &a, const tune_result_t &b) {
+  if (a.images_per_s != b.images_per_s) return a.images_per_s > b.images_per_s;
+  if (a.dsp != b.dsp) return a.dsp < b.dsp;
+  if (a.bram18k != b.bram18k) return a.bram18k < b.bram18k;
+  return a.lut < b.lut;
+}
+
+std::vector<tune_result_t> autotune(network_t *net,
+                                    const tune_budget_t &budget) {
+  std::vector<tune_result_t> results;
+  for (int n_pe = 1; n_pe <= TUNE_MAX_PE; n_pe++) {
+    for (int lines = 3; lines <= 4; lines++) {
+      // (more than 9 x N_PE weights per word: no faster, only more BRAM)
+      for (int r = 1; r <= 9 * n_pe; r++) {
+        tune_config_t config = {n_pe, lines, r};
+        tune_result_t res = evaluateConfig(net, config, budget);
+        if (res.fits) results.push_back(res);
+      }
+    }
+  }
+  std::sort(results.begin(), results.end(), betterResult);
+  return results;
+}
+
+// ==========
+// = Report =
+// ==========
+
+static tune_config_t currentConfig() {
+  tune_config_t config = {N_PE, NUM_IMG_CACHE_LINES, WCACHE_RESHAPE_FACTOR};
+  return config;
+}
+
+static void printResultLine(const char *label, const tune_result_t &res,
+                            FILE *out) {
+  fprintf(out, "%8s: %5d %6d %8d %6d %6d %8d %12.0f %10.2f%s\n", label,
+          res.config.n_pe, res.config.img_cache_lines,
+          res.config.wcache_reshape, res.dsp, res.bram18k, res.lut,
+          res.cycles, res.images_per_s, res.fits ? "" : " (over budget)");
+}
+
+void printAutotuneReport(network_t *net, const tune_budget_t &budget,
+                         const std::vector<tune_result_t> &results,
+                         int num_shown, FILE *out) {
+  fprintf(out, "Autotuner (budget: %d DSP, %d BRAM18K, %d LUT; %d layers):\n",
+          budget.dsp, budget.bram18k, budget.lut, (int)net->num_layers);
+  fprintf(out, "%8s: %5s %6s %8s %6s %6s %8s %12s %10s\n", "config", "N_PE",
+          "lines", "reshape", "DSP", "BRAM", "LUT", "cycles", "images/s");
+  printResultLine("current", evaluateConfig(net, currentConfig(), budget),
+                  out);
+  for (int i = 0; i < std::min(num_shown, (int)results.size()); i++) {
+    char label[16];
+    snprintf(label, sizeof(label), "#%d", i + 1);
+    printResultLine(label, results[i], out);
+  }
+  if (results.empty()) {
+    fprintf(out, "\nNo configuration fits the budget.\n");
+    return;
+  }
+
+  // Emit Constants + Directives of the best Configuration
+  const tune_config_t &best = results[0].config;
+  const tune_limits_t &lim = results[0].limits;
+  fprintf(out, "\n// fpga_top.hpp\n");
+  fprintf(out, "const int NUM_IMG_CACHE_LINES = %d;\n", best.img_cache_lines);
+  fprintf(out, "const int N_PE = %d;\n", best.n_pe);
+  fprintf(out, "const int WCACHE_RESHAPE_FACTOR = %d;\n", best.wcache_reshape);
+  fprintf(out, "\n// network.hpp\n");
+  fprintf(out, "const int MAX_NUM_LAYERS = %d;\n", lim.num_layers);
+  fprintf(out, "const int MAX_WEIGHTS_PER_LAYER = %d;\n",
+          lim.weights_per_layer);
+  fprintf(out, "const int MAX_IMAGE_CACHE_SIZE = %d;\n", lim.image_cache_size);
+  fprintf(out, "const int MAX_INPUT_PER_LAYER = %d;\n", lim.input_per_layer);
+  fprintf(out, "const int MAX_NUM_CHOUT = %d;\n", lim.num_chout);
+  fprintf(out, "const int MAX_DIMENSION = %d;\n", lim.dimension);
+  fprintf(out, "const int MAX_CHANNELS = %d;\n", lim.channels);
+  fprintf(out, "const int MAX_POOL_CACHE_SIZE = %d;\n", lim.pool_cache_size);
+  fprintf(out, "\n# ZynqNet/zynq/directives.tcl (replaces the ARRAY_RESHAPE "
+               "pragma in weights_cache.cpp)\n");
+  fprintf(out, "set_directive_array_reshape -type cyclic -factor %d -dim 1 "
+               "\"WeightsCache::WeightsCache\" BRAM\n", best.wcache_reshape);
+  if (best.n_pe > 1) {
+    fprintf(out, "set_directive_unroll -factor %d "
+                 "\"ProcessingElement::processAllCHout/L_CH_OUT\"\n",
+            best.n_pe);
+    fprintf(out, "set_directive_array_reshape -type cyclic -factor %d "
+                 "-dim 1 \"OutputCache::OutputCache\" BRAM\n", best.n_pe);
+  }
+}
+
+static void printResultJSON(const tune_result_t &res, FILE *out) {
+  const tune_limits_t &lim = res.limits;
+  fprintf(out,
+          "{\"n_pe\": %d, \"img_cache_lines\": %d, \"wcache_reshape\": %d, "
+          "\"dsp\": %d, \"bram18k\": %d, \"lut\": %d, \"fits\": %s, "
+          "\"cycles\": %.0f, \"images_per_s\": %.4f, \"limits\": "
+          "{\"MAX_NUM_LAYERS\": %d, \"MAX_WEIGHTS_PER_LAYER\": %d, "
+          "\"MAX_IMAGE_CACHE_SIZE\": %d, \"MAX_INPUT_PER_LAYER\": %d, "
+          "\"MAX_NUM_CHOUT\": %d, \"MAX_DIMENSION\": %d, "
+          "\"MAX_CHANNELS\": %d, \"MAX_POOL_CACHE_SIZE\": %d}}",
+          res.config.n_pe, res.config.img_cache_lines,
+          res.config.wcache_reshape, res.dsp, res.bram18k, res.lut,
+          res.fits ? "true" : "false", res.cycles, res.images_per_s,
+          lim.num_layers, lim.weights_per_layer, lim.image_cache_size,
+          lim.input_per_layer, lim.num_chout, lim.dimension, lim.channels,
+          lim.pool_cache_size);
+}
+
+void printAutotuneJSON(network_t *net, const tune_budget_t &budget,
+                       const std::vector<tune_result_t> &results,
+                       int num_shown, FILE *out) {
+  fprintf(out, "{\n  \"budget\": {\"dsp\": %d, \"bram18k\": %d, \"lut\": %d},"
+               "\n  \"current\": ",
+          budget.dsp, budget.bram18k, budget.lut);
+  printResultJSON(evaluateConfig(net, currentConfig(), budget), out);
+  fprintf(out, ",\n  \"best\": [");
+  int n = std::min(num_shown, (int)results.size());
+  for (int i = 0; i < n; i++) {
+    fprintf(out, "\n    ");
+    printResultJSON(results[i], out);
+    if (i < n - 1) fprintf(out, ",");
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
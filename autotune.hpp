@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  autotune.hpp
+//
+//  Architecture Autotuner (Performance Model + Resource Estimate per Config)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef AUTOTUNE_HPP_C81F5A37
+#define AUTOTUNE_HPP_C81F5A37
+
+#include <cstdio>
+#include <vector>
+#include "perf_model.hpp"
+
+// ===================
+// = Resource Budget =
+// ===================
+// Device of the HLS project (script.tcl: set_part xc7z045fbg676-3)
+const int XC7Z045_DSP = 900;
+const int XC7Z045_BRAM18K = 1090;
+const int XC7Z045_LUT = 218600;
+
+struct tune_budget_t {
+  int dsp;
+  int bram18k;
+  int lut;
+};
+// UTILIZATION of the xc7z045 (headroom for routing + timing closure)
+tune_budget_t xc7z045Budget(double utilization);
+
+// ================
+// = Search Space =
+// ================
+// Build-time parameters (fpga_top.hpp + HLS directives)
+struct tune_config_t {
+  int n_pe;             // N_PE: L_CH_OUT unrolled, OutputCache reshaped
+  int img_cache_lines;  // NUM_IMG_CACHE_LINES (3..4, cacheline_t: 2 bit)
+  int wcache_reshape;   // ARRAY_RESHAPE cyclic factor of WeightsCache::BRAM
+};
+const int TUNE_MAX_PE = 64;
+
+// Size Limits (network.hpp) needed by a network (as checkNetworkLimits())
+struct tune_limits_t {
+  int num_layers;        // MAX_NUM_LAYERS
+  int weights_per_layer; // MAX_WEIGHTS_PER_LAYER (incl. biases)
+  int image_cache_size;  // MAX_IMAGE_CACHE_SIZE (for img_cache_lines)
+  int input_per_layer;   // MAX_INPUT_PER_LAYER
+  int num_chout;         // MAX_NUM_CHOUT
+  int dimension;         // MAX_DIMENSION
+  int channels;          // MAX_CHANNELS
+  int pool_cache_size;   // MAX_POOL_CACHE_SIZE
+};
+tune_limits_t networkLimits(network_t *net, int img_cache_lines);
+
+// =========================
+// = Evaluate one Config   =
+// =========================
+// Resources: floating-point operators of the PEs + BRAM of all caches
+// (rough 7-series estimates, calibrate with a synthesis report)
+// Performance: perf_model with the L_CH_OUT initiation interval limited by
+// the WeightsCache ports (N_PE x 9 weights per cycle from 2 ports of
+// wcache_reshape words each)
+struct tune_result_t {
+  tune_config_t config;
+  tune_limits_t limits;
+  int dsp;
+  int bram18k;
+  int lut;
+  bool fits;  // within budget
+  double cycles;
+  double images_per_s;
+};
+tune_result_t evaluateConfig(network_t *net, const tune_config_t &config,
+                             const tune_budget_t &budget);
+
+// ==========================
+// = Search all Configs     =
+// ==========================
+// Returns all configurations that fit the budget, best images/s first
+// (ties: fewer DSP, BRAM, LUT)
+std::vector<tune_result_t> autotune(network_t *net,
+                                    const tune_budget_t &budget);
+
+// ==========
+// = Report =
+// ==========
+// Best NUM_SHOWN configs, current build for comparison, then the constants
+// (network.hpp, fpga_top.hpp) and directives (directives.tcl) of the best
+void printAutotuneReport(network_t *net, const tune_budget_t &budget,
+                         const std::vector<tune_result_t> &results,
+                         int num_shown, FILE *out);
+// Same content as JSON object {"budget": .., "current": .., "best": [..]}
+void printAutotuneJSON(network_t *net, const tune_budget_t &budget,
+                       const std::vector<tune_result_t> &results,
+                       int num_shown, FILE *out);
+
+#endif /* end of include guard: AUTOTUNE_HPP_C81F5A37 */
@@ -0,0 +1,345 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  bench.cpp
+//
+//  Microbenchmarks: C-Sim Throughput of FPGA Modules and fpga_top per Layer
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+// Usage: bench [--json <file>] [--reps N] [--min-time s] [--warmup N]
+//              [--filter <substring>] [--layer L] [<model file>]
+// (built + run by "make bench"; without model file: network.cpp + weights.bin)
+//
+// - module benchmarks use the shape of layer L (default: layer with the most
+//   MACs, max pooling: first layer with fused max pooling)
+// - fpga_top is run for every layer alone (first_layer = last_layer) and for
+//   the whole network
+// - throughput is given per median repetition: elements/s (words moved or
+//   cache accesses) or MACs/s (multiply-accumulates executed incl. padding)
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "microbench.hpp"
+#include "network.hpp"  // load before netconfig.hpp for bit-width calculation
+#include "netconfig.hpp"
+#include "fpga_top.hpp"
+#include "memory_controller.hpp"
+#include "image_cache.hpp"
+#include "weights_cache.hpp"
+#include "output_cache.hpp"
+#include "pooling_cache.hpp"
+#include "processing_element.hpp"
+#include "model_file.hpp"
+#include "perf_model.hpp"
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"
+#endif
+#ifdef NATIVE_INT_TYPES
+#define BENCH_BUILD "native_int"
+#else
+#define BENCH_BUILD "ap_int"
+#endif
+
+// ======================
+// = Benchmark DRAM     =
+// ======================
+// Same layout as allocate_FPGA_memory() + copy_config_to_FPGA() (cpu_top),
+// one data slot filled with pseudo-random input, no stats section
+struct bench_dram_t {
+  std::vector<data_t> memory;
+  unsigned int weights_offset;
+  unsigned int input_offset;
+};
+
+static void setupBenchDRAM(network_t *net, bench_dram_t &dram) {
+  int configsize = net->num_layers * NUM_FLOATS_PER_LAYER;
+  dram.weights_offset = configsize;
+  dram.input_offset = configsize + net->num_weights;
+  dram.memory.assign(dram.input_offset + net->total_pixel_mem, 0.0f);
+
+  for (int l = 0; l < net->num_layers; l++)
+    layer_to_floats(net->layers[l], &dram.memory[l * NUM_FLOATS_PER_LAYER]);
+  memcpy(&dram.memory[dram.weights_offset], net->weights,
+         net->num_weights * sizeof(data_t));
+
+  // Input Image: deterministic values in [-1, 1)
+  layer_t &first = net->layers[0];
+  int num_pixels = first.width * first.height * first.channels_in;
+  unsigned int seed = 1;
+  for (int i = 0; i < num_pixels; i++) {
+    seed = seed * 1103515245 + 12345;
+    dram.memory[dram.input_offset + i] = ((seed >> 8) & 0xFFFF) / 32768.0f - 1;
+  }
+}
+
+static std::string layerName(layer_t &layer) {
+  std::string name(layer.name);
+  name.erase(name.find_last_not_of(' ') + 1);
+  return name;
+}
+
+// =====================
+// = Module Benchmarks =
+// =====================
+// Modules are driven in the order of fpga_top() for the shape of LAYER
+// (module instances on the heap: BRAM arrays are too big for the stack)
+
+static void benchModules(MicroBenchmark &bench, bench_dram_t &dram,
+                         layer_t layer, layer_t pool_layer) {
+  MemoryController DRAM(&dram.memory[0], dram.weights_offset,
+                        dram.input_offset);
+  ImageCache *ICache = new ImageCache();
+  WeightsCache *WCache = new WeightsCache();
+  OutputCache *OCache = new OutputCache("OCache");
+  PoolingCache *PCache = new PoolingCache();
+  ProcessingElement *PE = new ProcessingElement();
+  PE->setup(ICache, WCache, OCache);
+
+  std::string suffix = " [" + layerName(layer) + "]";
+  int ch_in = layer.channels_in, ch_out = layer.channels_out;
+  int ch_out_per_group = ch_out / layer.groups;
+  int num_weights = ch_in * ch_out_per_group * layer.kernel * layer.kernel;
+  int width_out = layer.width / layer.stride;
+  int height_out = layer.height / layer.stride;
+  int num_input_words = layer.width * layer.height * ch_in;
+
+  // MemoryController
+  bench.run("MemoryController::loadNextWeight" + suffix, "elements",
+            num_weights + ch_out, [&]() {
+    DRAM.setLayerConfig(layer);
+    data_t sum = 0;
+    for (int i = 0; i < num_weights + ch_out; i++) sum += DRAM.loadNextWeight();
+    benchSink(sum);
+  });
+  bench.run("MemoryController::loadNextChannel" + suffix, "elements",
+            num_input_words, [&]() {
+    DRAM.setLayerConfig(layer);
+    DRAM.setPixelLoadRow(0);
+    data_t sum = 0;
+    for (int i = 0; i < num_input_words; i++) sum += DRAM.loadNextChannel();
+    benchSink(sum);
+  });
+  bench.run("MemoryController::storeNextChannel" + suffix, "elements",
+            (double)width_out * height_out * ch_out, [&]() {
+    layer_t unpooled = layer;
+    unpooled.pool = POOL_NONE;
+    DRAM.setLayerConfig(unpooled);
+    for (int y = 0; y < height_out; y++) {
+      for (int x = 0; x < width_out; x++) {
+        DRAM.setOutputPixel(y, x);
+        for (int co = 0; co < ch_out; co++) DRAM.storeNextChannel(co);
+      }
+    }
+  });
+
+  // WeightsCache
+  bench.run("WeightsCache::loadFromDRAM" + suffix, "elements",
+            num_weights + ch_out, [&]() {
+    DRAM.setLayerConfig(layer);
+    WCache->setLayerConfig(layer);
+    WCache->loadFromDRAM(&DRAM);
+  });
+  bench.run("WeightsCache::getNineWeights" + suffix, "elements",
+            (double)ch_in * ch_out_per_group, [&]() {
+    data_t wbuffer[9], sum = 0;
+    for (int ci = 0; ci < ch_in; ci++) {
+      WCache->setInputChannel(ci);
+      for (int co = 0; co < ch_out_per_group; co++) {
+        if (layer.kernel == 3)
+          WCache->getNineWeights<3>(co, wbuffer);
+        else
+          WCache->getNineWeights<1>(co, wbuffer);
+        sum += wbuffer[4];
+      }
+    }
+    benchSink(sum);
+  });
+
+  // ImageCache
+  bench.run("ImageCache::preloadPixelFromDRAM" + suffix, "elements",
+            num_input_words, [&]() {
+    DRAM.setLayerConfig(layer);
+    ICache->setLayerConfig(layer);
+    DRAM.setPixelLoadRow(0);
+    for (int i = 0; i < layer.width * layer.height; i++)
+      ICache->preloadPixelFromDRAM(&DRAM);
+  });
+  // (first rows of the layer in the cache for getPixel + PE)
+  int num_rows = std::min((int)layer.height, NUM_IMG_CACHE_LINES - 1);
+  DRAM.setLayerConfig(layer);
+  ICache->setLayerConfig(layer);
+  DRAM.setPixelLoadRow(0);
+  for (int y = 0; y < num_rows; y++) ICache->preloadRowFromDRAM(&DRAM);
+  bench.run("ImageCache::getPixel" + suffix, "elements",
+            (double)num_rows * layer.width * ch_in, [&]() {
+    data_t sum = 0;
+    for (int y = 0; y < num_rows; y++)
+      for (int x = 0; x < layer.width; x++)
+        for (int ci = 0; ci < ch_in; ci++) sum += ICache->getPixel(y, x, ci);
+    benchSink(sum);
+  });
+
+  // ProcessingElement: one row of input pixels, all input channels
+  // (row 1: full 3x3 window where the layer has enough rows)
+  int y_pe = std::min(1, (int)layer.height - 1);
+  WCache->setLayerConfig(layer);
+  WCache->loadFromDRAM(&DRAM);
+  PE->setLayerConfig(layer);
+  bench.run("ProcessingElement::processInputChannel" + suffix, "MACs",
+            (double)layer.width * num_weights, [&]() {
+    for (int x = 0; x < layer.width; x++) {
+      OCache->reset();
+      for (int ci = 0; ci < ch_in; ci++) {
+        if (layer.kernel == 3)
+          PE->processInputChannel<3, 1>(y_pe, x, ci);
+        else
+          PE->processInputChannel<1, 0>(y_pe, x, ci);
+      }
+    }
+    benchSink(OCache->getChannel(0));
+  });
+
+  // OutputCache
+  bench.run("OutputCache::accumulateChannel" + suffix, "elements",
+            (double)width_out * ch_out, [&]() {
+    for (int x = 0; x < width_out; x++)
+      for (int co = 0; co < ch_out; co++) OCache->accumulateChannel(co, 1.0f);
+    benchSink(OCache->getChannel(0));
+  });
+
+  // PoolingCache: all conv output pixels of the max pooling layer
+  if (pool_layer.pool == POOL_2x2S2 || pool_layer.pool == POOL_3x3S2) {
+    int pw = pool_layer.width / pool_layer.stride;
+    int ph = pool_layer.height / pool_layer.stride;
+    bench.run("PoolingCache::poolPixel [" + layerName(pool_layer) + "]",
+              "elements", (double)pw * ph * pool_layer.channels_out, [&]() {
+      DRAM.setLayerConfig(pool_layer);
+      PCache->setLayerConfig(pool_layer);
+      for (int y = 0; y < ph; y++)
+        for (int x = 0; x < pw; x++) PCache->poolPixel(y, x, OCache, &DRAM);
+    });
+  }
+
+  delete ICache;
+  delete WCache;
+  delete OCache;
+  delete PCache;
+  delete PE;
+}
+
+// =======================
+// = fpga_top Benchmarks =
+// =======================
+
+static void benchFPGATop(MicroBenchmark &bench, bench_dram_t &dram,
+                         network_t *net) {
+  perf_arch_t arch = defaultPerfArch();
+  double total_macs = 0;
+  for (int l = 0; l < net->num_layers; l++) {
+    layer_t &layer = net->layers[l];
+    double macs = estimateLayerPerformance(&layer, arch).macs;
+    total_macs += macs;
+    char name[64];
+    snprintf(name, sizeof(name), "fpga_top/layer%02d [%s]", l,
+             layerName(layer).c_str());
+    bench.run(name, "MACs", macs, [&]() {
+      fpga_top(&dram.memory[0], net->num_layers, dram.weights_offset,
+               dram.input_offset, 0, l, l);
+    });
+  }
+  bench.run("fpga_top/network", "MACs", total_macs, [&]() {
+    fpga_top(&dram.memory[0], net->num_layers, dram.weights_offset,
+             dram.input_offset);
+  });
+}
+
+// ========
+// = Main =
+// ========
+
+int main(int argc, char **argv) {
+  bench_settings_t settings = defaultBenchSettings();
+  const char *json_file = NULL;
+  const char *model_file = NULL;
+  int module_layer = -1;
+  for (int arg = 1; arg < argc; arg++) {
+    std::string opt(argv[arg]);
+    bool has_value = (arg + 1 < argc);
+    if (opt == "--json" && has_value) {
+      json_file = argv[++arg];
+    } else if (opt == "--reps" && has_value) {
+      settings.min_reps = std::max(1, atoi(argv[++arg]));
+    } else if (opt == "--min-time" && has_value) {
+      settings.min_seconds = atof(argv[++arg]);
+    } else if (opt == "--warmup" && has_value) {
+      settings.warmup = std::max(0, atoi(argv[++arg]));
+    } else if (opt == "--filter" && has_value) {
+      settings.filter = argv[++arg];
+    } else if (opt == "--layer" && has_value) {
+      module_layer = atoi(argv[++arg]);
+    } else if (opt[0] != '-' && !model_file) {
+      model_file = argv[arg];
+    } else {
+      printf("ERROR: unknown argument %s\n", argv[arg]);
+      printf("Usage: %s [--json <file>] [--reps N] [--min-time s] "
+             "[--warmup N] [--filter <substring>] [--layer L] "
+             "[<model file>]\n", argv[0]);
+      return -1;
+    }
+  }
+
+  network_t *net = model_file ? loadModelFile(model_file)
+                              : get_network_config();
+  if (!checkNetworkLimits(net)) return -1;
+  if (module_layer >= (int)net->num_layers) {
+    printf("ERROR: layer %d does not exist (%d layers)\n", module_layer,
+           (int)net->num_layers);
+    return -1;
+  }
+
+  // Module Shapes: busiest layer, first max pooling layer
+  perf_arch_t arch = defaultPerfArch();
+  int pool_layer = 0;
+  for (int l = net->num_layers - 1; l >= 0; l--)
+    if (net->layers[l].pool == POOL_2x2S2 || net->layers[l].pool == POOL_3x3S2)
+      pool_layer = l;
+  if (module_layer < 0) {
+    module_layer = 0;
+    for (int l = 1; l < net->num_layers; l++)
+      if (estimateLayerPerformance(&net->layers[l], arch).macs >
+          estimateLayerPerformance(&net->layers[module_layer], arch).macs)
+        module_layer = l;
+  }
+
+  bench_dram_t dram;
+  setupBenchDRAM(net, dram);
+  printf("BENCH: revision %s, %s build, %d layers\n", BENCH_REVISION,
+         BENCH_BUILD, (int)net->num_layers);
+
+  MicroBenchmark bench(settings);
+  FPGA_TOP_QUIET = true;  // no start / finish message per repetition
+  benchModules(bench, dram, net->layers[module_layer],
+               net->layers[pool_layer]);
+  benchFPGATop(bench, dram, net);
+
+  bench.printTable(stdout);
+  if (json_file) {
+    FILE *out = fopen(json_file, "w");
+    if (!out) {
+      printf("ERROR: File %s could not be opened!\n", json_file);
+      return -1;
+    }
+    bench.printJSON(out, BENCH_REVISION, BENCH_BUILD);
+    fclose(out);
+    printf("BENCH: results written to %s\n", json_file);
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  microbench.cpp
+//
+//  Microbenchmark Runner (warm-up, repetitions, statistics, JSON report)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "microbench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+bench_settings_t defaultBenchSettings() {
+  bench_settings_t settings;
+  settings.warmup = 1;
+  settings.min_reps = 3;
+  settings.max_reps = 1000;
+  settings.min_seconds = 0.5;
+  settings.filter = "";
+  return settings;
+}
+
+volatile float bench_sink_value;
+void benchSink(float value) { bench_sink_value = value; }
+
+// ==========================
+// = Class MicroBenchmark   =
+// ==========================
+
+MicroBenchmark::MicroBenchmark(const bench_settings_t &settings)
+    : _settings(settings) {}
+
+bool MicroBenchmark::run(const std::string &name, const char *unit,
+                         double work, std::function<void()> fn) {
+  typedef std::chrono::steady_clock clock;
+  if (name.find(_settings.filter) == std::string::npos) return false;
+
+  // Warm-up (caches, page faults, branch predictors)
+  for (int i = 0; i < _settings.warmup; i++) fn();
+
+  // Timed Repetitions
+  std::vector<double> times;
+  double total_seconds = 0;
+  while ((int)times.size() < _settings.max_reps &&
+         ((int)times.size() < _settings.min_reps ||
+          total_seconds < _settings.min_seconds)) {
+    clock::time_point start = clock::now();
+    fn();
+    double ms = std::chrono::duration<double, std::milli>(clock::now() - start)
+                    .count();
+    times.push_back(ms);
+    total_seconds += ms / 1000;
+  }
+
+  // Statistics
+  bench_result_t r;
+  r.name = name;
+  r.unit = unit;
+  r.work = work;
+  r.reps = times.size();
+  std::sort(times.begin(), times.end());
+  r.min_ms = times[0];
+  r.median_ms = (r.reps % 2) ? times[r.reps / 2]
+                             : (times[r.reps / 2 - 1] + times[r.reps / 2]) / 2;
+  r.mean_ms = 0;
+  for (int i = 0; i < r.reps; i++) r.mean_ms += times[i] / r.reps;
+  double var = 0;
+  for (int i = 0; i < r.reps; i++)
+    var += (times[i] - r.mean_ms) * (times[i] - r.mean_ms);
+  r.stddev_ms = (r.reps > 1) ? std::sqrt(var / (r.reps - 1)) : 0;
+  r.throughput = work / std::max(r.median_ms / 1000, 1e-12);
+  _results.push_back(r);
+
+  printf("BENCH: %-48s %5d reps, median %10.3f ms, %9.3f M%s/s\n",
+         name.c_str(), r.reps, r.median_ms, r.throughput / 1e6, unit);
+  fflush(stdout);
+  return true;
+}
+
+// ==========
+// = Report =
+// ==========
+
+void MicroBenchmark::printTable(FILE *out) {
+  fprintf(out, "\nBenchmark Results (times per repetition):\n");
+  fprintf(out, "%-48s %5s %10s %10s %10s %9s %12s\n", "benchmark", "reps",
+          "min ms", "median ms", "mean ms", "stddev", "throughput");
+  for (size_t i = 0; i < _results.size(); i++) {
+    const bench_result_t &r = _results[i];
+    fprintf(out, "%-48s %5d %10.3f %10.3f %10.3f %8.1f%% %8.3f M%s/s\n",
+            r.name.c_str(), r.reps, r.min_ms, r.median_ms, r.mean_ms,
+            100 * r.stddev_ms / std::max(r.mean_ms, 1e-12),
+            r.throughput / 1e6, r.unit.c_str());
+  }
+}
+
+void MicroBenchmark::printJSON(FILE *out, const char *revision,
+                               const char *build) {
+  fprintf(out, "{\n  \"revision\": \"%s\",\n  \"build\": \"%s\",\n", revision,
+          build);
+  fprintf(out,
+          "  \"settings\": {\"warmup\": %d, \"min_reps\": %d, "
+          "\"max_reps\": %d, \"min_seconds\": %g},\n",
+          _settings.warmup, _settings.min_reps, _settings.max_reps,
+          _settings.min_seconds);
+  fprintf(out, "  \"benchmarks\": [\n");
+  for (size_t i = 0; i < _results.size(); i++) {
+    const bench_result_t &r = _results[i];
+    fprintf(out,
+            "    {\"name\": \"%s\", \"unit\": \"%s\", \"work\": %.0f, "
+            "\"reps\": %d, \"min_ms\": %.6f, \"median_ms\": %.6f, "
+            "\"mean_ms\": %.6f, \"stddev_ms\": %.6f, "
+            "\"throughput_per_s\": %.6g}%s\n",
+            r.name.c_str(), r.unit.c_str(), r.work, r.reps, r.min_ms,
+            r.median_ms, r.mean_ms, r.stddev_ms, r.throughput,
+            (i + 1 < _results.size()) ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  microbench.hpp
+//
+//  Microbenchmark Runner (warm-up, repetitions, statistics, JSON report)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef MICROBENCH_HPP_B7D2496E
+#define MICROBENCH_HPP_B7D2496E
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// =======================
+// = Benchmark Settings  =
+// =======================
+struct bench_settings_t {
+  int warmup;          // untimed executions before measuring
+  int min_reps;        // at least this many timed repetitions ...
+  int max_reps;        // ... but at most this many
+  double min_seconds;  // repeat until total timed duration reaches this
+  std::string filter;  // only run benchmarks whose name contains FILTER
+};
+bench_settings_t defaultBenchSettings();
+
+// ====================
+// = Benchmark Result =
+// ====================
+// Times of one repetition (ms), throughput = work / median time
+struct bench_result_t {
+  std::string name;
+  std::string unit;  // unit of WORK ("elements", "MACs")
+  double work;       // units processed per repetition
+  int reps;
+  double min_ms, median_ms, mean_ms, stddev_ms;
+  double throughput;  // units / s
+};
+
+// ==========================
+// = Class MicroBenchmark   =
+// ==========================
+class MicroBenchmark {
+ public:
+  MicroBenchmark(const bench_settings_t &settings);
+  // Run FN (warm-up + repetitions), print one line to stdout
+  // (skipped if NAME does not match the filter: returns false)
+  bool run(const std::string &name, const char *unit, double work,
+           std::function<void()> fn);
+  const std::vector<bench_result_t> &results() { return _results; }
+  // Table of all results (name, reps, min / median / mean / stddev, rate)
+  void printTable(FILE *out);
+  // JSON object {"revision": .., "build": .., "settings": ..,
+  // "benchmarks": [..]}, stable keys for comparison between commits
+  void printJSON(FILE *out, const char *revision, const char *build);
+
+ private:
+  bench_settings_t _settings;
+  std::vector<bench_result_t> _results;
+};
+
+// Sink for benchmark results (keeps the compiler from removing the work)
+void benchSink(float value);
+
+#endif /* end of include guard: MICROBENCH_HPP_B7D2496E */
@@ -0,0 +1,293 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  cpu_engine.cpp
+//
+//  Optimized CPU Inference Engine (golden model + fallback for the FPGA)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "cpu_engine.hpp"
+#include "layer_profile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+typedef CPUEngine::cpulayer_t cpulayer_t;
+
+// =======================
+// = Convolution Kernels =
+// =======================
+// One generic kernel body, compiled once per instruction set: it is inlined
+// into the target-specific wrappers below, where the compiler vectorizes the
+// innermost loop (contiguous output channels) for AVX2 / AVX-512.
+// Same arithmetic as the FPGA: 3x3 kernels are always zero-padded by one
+// pixel, stride 2 evaluates every second input pixel.
+static inline __attribute__((always_inline)) void convolutionBody(
+    const cpulayer_t &L, const data_t *input, const data_t *bypass,
+    data_t *output) {
+  const int ch_in_per_group = L.ch_in / L.groups;
+  const int ch_out_per_group = L.ch_out / L.groups;
+  const int border = (L.kernel == 3) ? 1 : 0;
+  alignas(64) data_t acc[CPU_PIXEL_BLOCK][CPU_CHANNEL_BLOCK];
+
+  for (int g = 0; g < L.groups; g++) {
+    for (int y_out = 0; y_out < L.height_out; y_out++) {
+      for (int x0 = 0; x0 < L.width_out; x0 += CPU_PIXEL_BLOCK) {
+        const int np = std::min(CPU_PIXEL_BLOCK, L.width_out - x0);
+        for (int co0 = 0; co0 < ch_out_per_group; co0 += CPU_CHANNEL_BLOCK) {
+          const int nc = std::min(CPU_CHANNEL_BLOCK, ch_out_per_group - co0);
+          const int co_first = g * ch_out_per_group + co0;
+
+          // Initialize with Bias
+          for (int p = 0; p < np; p++)
+            for (int c = 0; c < nc; c++) acc[p][c] = L.bias[co_first + c];
+
+          // Accumulate all Kernel Taps + Input Channels of this Group
+          for (int ky = 0; ky < L.kernel; ky++) {
+            const int y = y_out * L.stride + ky - border;
+            if (y < 0 || y >= L.height) continue;
+            for (int kx = 0; kx < L.kernel; kx++) {
+              const int tap = ky * L.kernel + kx;
+              for (int ci = g * ch_in_per_group;
+                   ci < (g + 1) * ch_in_per_group; ci++) {
+                const data_t *w =
+                    L.weights + (tap * L.ch_in + ci) * ch_out_per_group + co0;
+                for (int p = 0; p < np; p++) {
+                  const int x = (x0 + p) * L.stride + kx - border;
+                  if (x < 0 || x >= L.width) continue;
+                  const data_t px = input[(y * L.width + x) * L.ch_in + ci];
+                  data_t *a = acc[p];
+                  for (int c = 0; c < nc; c++) a[c] += px * w[c];
+                }
+              }
+            }
+          }
+
+          // Bypass (residual connection, same layout as written output) +
+          // ReLU, store into dense output
+          for (int p = 0; p < np; p++) {
+            const int x_out = x0 + p;
+            data_t *out = output +
+                          (y_out * L.width_out + x_out) * L.ch_out + co_first;
+            const data_t *byp =
+                bypass + (y_out * L.width_wb + x_out) * L.out_pixel_stride +
+                L.out_channel_offset + co_first;
+            for (int c = 0; c < nc; c++) {
+              data_t v = acc[p][c];
+              if (L.has_bypass) v += byp[c];
+              out[c] = (v < 0) ? 0.0f : v;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+static void convolutionScalar(const cpulayer_t &L, const data_t *input,
+                              const data_t *bypass, data_t *output) {
+  convolutionBody(L, input, bypass, output);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,fma"))) static void convolutionAVX2(
+    const cpulayer_t &L, const data_t *input, const data_t *bypass,
+    data_t *output) {
+  convolutionBody(L, input, bypass, output);
+}
+
+__attribute__((target("avx512f"))) static void convolutionAVX512(
+    const cpulayer_t &L, const data_t *input, const data_t *bypass,
+    data_t *output) {
+  convolutionBody(L, input, bypass, output);
+}
+#endif
+
+// ====================
+// = Class CPU ENGINE =
+// ====================
+
+CPUEngine::CPUEngine(network_t *net, isa_t max_isa)
+    : net(net), owns_weights(true) {
+  // Select best Kernel supported by this CPU
+  selected_isa = ISA_SCALAR;
+  convKernel = convolutionScalar;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (max_isa >= ISA_AVX512 && __builtin_cpu_supports("avx512f")) {
+    selected_isa = ISA_AVX512;
+    convKernel = convolutionAVX512;
+  } else if (max_isa >= ISA_AVX2 && __builtin_cpu_supports("avx2") &&
+             __builtin_cpu_supports("fma")) {
+    selected_isa = ISA_AVX2;
+    convKernel = convolutionAVX2;
+  }
+#endif
+
+  // Convert Layer Configuration, repack Weights
+  // FPGA layout: [ci][co / groups][tap], then bias[co]
+  // CPU layout:  [tap][ci][co / groups] (64-Byte aligned)
+  scratch_size = 1;
+  layers.resize(net->num_layers);
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    cpulayer_t &L = layers[i];
+    L.width = layer->width;
+    L.height = layer->height;
+    L.ch_in = layer->channels_in;
+    L.ch_out = layer->channels_out;
+    L.kernel = layer->kernel;
+    L.stride = layer->stride;
+    L.groups = layer->groups;
+    L.width_out = L.width / L.stride;
+    L.height_out = L.height / L.stride;
+    L.pool = layer->pool;
+    bool max_pool = (L.pool == POOL_2x2S2 || L.pool == POOL_3x3S2);
+    L.width_wb = max_pool ? pooled_dimension(L.width_out, L.pool) : L.width_out;
+    L.height_wb =
+        max_pool ? pooled_dimension(L.height_out, L.pool) : L.height_out;
+    L.has_bypass = layer->has_bypass;
+    L.mem_addr_input = layer->mem_addr_input;
+    L.mem_addr_output = layer->mem_addr_output;
+    L.mem_addr_bypass = layer->mem_addr_bypass;
+    L.out_pixel_stride = layer->out_pixel_stride;
+    L.out_channel_offset = layer->out_channel_offset;
+
+    int taps = L.kernel * L.kernel;
+    int ch_out_per_group = L.ch_out / L.groups;
+    int num_weights = taps * L.ch_in * ch_out_per_group;
+    data_t *fpga_weights = net->weights + (int)layer->mem_addr_weights;
+    size_t bytes = (num_weights + L.ch_out) * sizeof(data_t);
+    L.weights = (data_t *)aligned_alloc(64, (bytes + 63) / 64 * 64);
+    L.bias = L.weights + num_weights;
+    for (int ci = 0; ci < L.ch_in; ci++)
+      for (int co = 0; co < ch_out_per_group; co++)
+        for (int t = 0; t < taps; t++)
+          L.weights[(t * L.ch_in + ci) * ch_out_per_group + co] =
+              fpga_weights[(ci * ch_out_per_group + co) * taps + t];
+    memcpy(L.bias, fpga_weights + num_weights, L.ch_out * sizeof(data_t));
+
+    scratch_size =
+        std::max(scratch_size, L.width_out * L.height_out * L.ch_out);
+  }
+  scratch = (data_t *)aligned_alloc(
+      64, (scratch_size * sizeof(data_t) + 63) / 64 * 64);
+
+  printf("CPU: Engine set up for %d layers (%s kernels)\n",
+         (int)net->num_layers, isaName());
+}
+
+CPUEngine::CPUEngine(const CPUEngine &original)
+    : net(original.net),
+      selected_isa(original.selected_isa),
+      convKernel(original.convKernel),
+      layers(original.layers),
+      owns_weights(false),
+      scratch_size(original.scratch_size) {
+  scratch = (data_t *)aligned_alloc(
+      64, (scratch_size * sizeof(data_t) + 63) / 64 * 64);
+}
+
+CPUEngine::~CPUEngine() {
+  if (owns_weights)
+    for (int i = 0; i < (int)layers.size(); i++) free(layers[i].weights);
+  free(scratch);
+}
+
+CPUEngine::isa_t CPUEngine::isa() { return selected_isa; }
+
+const char *CPUEngine::isaName() {
+  if (selected_isa == ISA_AVX512) return "AVX-512";
+  if (selected_isa == ISA_AVX2) return "AVX2";
+  return "scalar";
+}
+
+void CPUEngine::run(data_t *data_section, int num_topk, int first_layer,
+                    int last_layer) {
+  if (last_layer < 0 || last_layer > (int)net->num_layers - 1)
+    last_layer = net->num_layers - 1;
+  for (int i = first_layer; i <= last_layer; i++) {
+    const cpulayer_t &L = layers[i];
+    if (layer_profile_enabled) layerProfileStart();
+    convKernel(L, data_section + L.mem_addr_input,
+               data_section + L.mem_addr_bypass, scratch);
+    if (L.pool != POOL_GLOBAL || i == last_layer)
+      writeBack(L, scratch, data_section, num_topk);
+    if (layer_profile_enabled)
+      layerProfileEnd(PROFILE_CPU_ENGINE, i, net->layers[i], -1, -1);
+  }
+}
+
+// =================================
+// = Write Back Output (+ Pooling) =
+// =================================
+// Same memory layout + result format as MemoryController on the FPGA
+void CPUEngine::writeBack(const cpulayer_t &L, const data_t *conv_out,
+                          data_t *data_section, int num_topk) {
+  data_t *output = data_section + L.mem_addr_output;
+
+  // Concatenated Output: pixels have out_pixel_stride channels, this layer
+  // writes channels out_channel_offset ...
+  if (L.pool == POOL_NONE) {
+    for (int p = 0; p < L.width_out * L.height_out; p++)
+      memcpy(output + p * L.out_pixel_stride + L.out_channel_offset,
+             conv_out + p * L.ch_out, L.ch_out * sizeof(data_t));
+    return;
+  }
+
+  // Max Pooling (windows clipped at right / bottom border)
+  if (L.pool == POOL_2x2S2 || L.pool == POOL_3x3S2) {
+    int window = (L.pool == POOL_3x3S2) ? 3 : 2;
+    for (int py = 0; py < L.height_wb; py++) {
+      for (int px = 0; px < L.width_wb; px++) {
+        data_t *out = output + (py * L.width_wb + px) * L.out_pixel_stride +
+                      L.out_channel_offset;
+        int y_end = std::min(2 * py + window, L.height_out);
+        int x_end = std::min(2 * px + window, L.width_out);
+        memcpy(out, conv_out + (2 * py * L.width_out + 2 * px) * L.ch_out,
+               L.ch_out * sizeof(data_t));
+        for (int y = 2 * py; y < y_end; y++)
+          for (int x = 2 * px; x < x_end; x++)
+            for (int c = 0; c < L.ch_out; c++)
+              out[c] = std::max(out[c], conv_out[(y * L.width_out + x) *
+                                                     L.ch_out + c]);
+      }
+    }
+    return;
+  }
+
+  // Global Pooling: accumulate in pixel order (as GPoolCache), average
+  int ch_out = L.ch_out;
+  int num_pixels = L.width_out * L.height_out;
+  std::vector<data_t> scores(ch_out, 0.0f);
+  for (int p = 0; p < num_pixels; p++)
+    for (int c = 0; c < ch_out; c++) scores[c] += conv_out[p * ch_out + c];
+  for (int c = 0; c < ch_out; c++) scores[c] /= (data_t)num_pixels;
+
+  if (num_topk == 0) {
+    // All Scores (FPGA averages only if GPOOL_AVERAGE_ON_FPGA)
+    for (int c = 0; c < ch_out; c++)
+      data_section[c] =
+          GPOOL_AVERAGE_ON_FPGA ? scores[c] : scores[c] * num_pixels;
+    return;
+  }
+
+  // Top-K (class, score) pairs + softmax normalizer (see writeBackTopK())
+  int k = std::min(std::min(num_topk, MAX_TOPK), ch_out);
+  std::vector<int> order(ch_out);
+  for (int c = 0; c < ch_out; c++) order[c] = c;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int a, int b) { return scores[a] > scores[b]; });
+  data_t expsum = 0.0f;
+  for (int c = 0; c < ch_out; c++)
+    expsum += std::exp(scores[c] - scores[order[0]]);
+  for (int j = 0; j < k; j++) {
+    data_section[2 * j] = (data_t)order[j];
+    data_section[2 * j + 1] = scores[order[j]];
+  }
+  data_section[2 * k] = expsum;
+}
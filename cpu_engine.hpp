@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  cpu_engine.hpp
+//
+//  Optimized CPU Inference Engine (golden model + fallback for the FPGA)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef CPU_ENGINE_HPP_3D8A61C5
+#define CPU_ENGINE_HPP_3D8A61C5
+
+#include <vector>
+#include "fpga_top.hpp"
+
+// ============================
+// = CPU Engine Configuration =
+// ============================
+// Cache Blocking: accumulators for CPU_PIXEL_BLOCK output pixels x
+// CPU_CHANNEL_BLOCK output channels stay in L1 while all input channels and
+// kernel taps are processed (same weights row is reused for all pixels)
+const int CPU_PIXEL_BLOCK = 8;
+const int CPU_CHANNEL_BLOCK = 64;
+
+// ====================
+// = Class CPU ENGINE =
+// ====================
+// Software implementation of the network, independent of the HLS C-Sim:
+// plain int / float types, weights repacked to [tap][ci][co / groups] so
+// the innermost loop runs over contiguous output channels (SIMD).
+// Uses the same network_t and activation memory plan as the FPGA: run()
+// works in place on a data section (input image at address 0) and writes
+// the results in the same format as fpga_top() (all scores or Top-K).
+// Kernels exist for AVX-512, AVX2 (+FMA) and plain C++, the best one
+// supported by the CPU is selected at runtime.
+// Not thread-safe (scratch buffer): use one CPUEngine per thread, copies
+// share the repacked weights of the original (read-only).
+class CPUEngine {
+ public:
+  typedef enum { ISA_SCALAR, ISA_AVX2, ISA_AVX512 } isa_t;
+  // max_isa: restrict kernel selection (e.g. ISA_SCALAR for comparison)
+  CPUEngine(network_t *net, isa_t max_isa = ISA_AVX512);
+  // Shares weights of ORIGINAL (must outlive the copy), own scratch buffer
+  CPUEngine(const CPUEngine &original);
+  ~CPUEngine();
+  isa_t isa();
+  const char *isaName();
+  // Execute layers first_layer .. last_layer (-1: last layer of network)
+  // on DATA_SECTION, final results only after the global pooling layer
+  // (num_topk = 0: all ch_out averaged scores, else Top-K pairs + normalizer)
+  void run(data_t *data_section, int num_topk = 0, int first_layer = 0,
+           int last_layer = -1);
+
+  // Layer Configuration + repacked Weights (plain types for the kernels)
+  struct cpulayer_t {
+    int width, height, ch_in, ch_out, kernel, stride, groups;
+    int width_out, height_out;  // after convolution (before max pooling)
+    int width_wb, height_wb;    // written back (after max pooling)
+    pooltype_t pool;
+    bool has_bypass;
+    int mem_addr_input, mem_addr_output, mem_addr_bypass;
+    int out_pixel_stride, out_channel_offset;
+    data_t *weights;  // [kernel * kernel][ch_in][ch_out / groups]
+    data_t *bias;     // [ch_out]
+  };
+  // Convolution + Bias + Bypass + ReLU of one layer into dense HWC OUTPUT
+  typedef void (*convkernel_t)(const cpulayer_t &layer, const data_t *input,
+                               const data_t *bypass, data_t *output);
+
+ private:
+  void writeBack(const cpulayer_t &layer, const data_t *conv_out,
+                 data_t *data_section, int num_topk);
+
+  network_t *net;
+  isa_t selected_isa;
+  convkernel_t convKernel;
+  std::vector<cpulayer_t> layers;
+  bool owns_weights;
+  int scratch_size;
+  data_t *scratch;  // dense conv output of one layer
+};
+
+#endif /* end of include guard: CPU_ENGINE_HPP_3D8A61C5 */
@@ -11,16 +11,15 @@
 //------------------------------------------------------------------------------
 
 #include "cpu_top.hpp"
-
-// ======================================
-// = Global Variables (Memory Pointers) =
-// ======================================
-// Pointers to Shared DRAM Memory
-char *SHARED_DRAM;
-// layer_t *SHARED_DRAM_LAYER_CONFIG;
-float *SHARED_DRAM_LAYER_CONFIG;
-data_t *SHARED_DRAM_WEIGHTS;
-data_t *SHARED_DRAM_DATA;
+#include "runtime.hpp"
+#include "cpu_engine.hpp"
+#include "regression.hpp"
+#include "perf_model.hpp"
+#include "autotune.hpp"
+#include "dram_trace.hpp"
+#include "layer_profile.hpp"
+#include "log_trace.hpp"
+#include <unistd.h>  // dup(), dup2() for --serve
 
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
@@ -29,7 +28,39 @@ data_t *SHARED_DRAM_DATA;
 // = Main Function =
 // =================
 
-int main() {
+// Usage: ./test                            compiled-in network (network.cpp)
+//        ./test <model file>               network + weights from model file
+//        ./test --save-model <model file>  write compiled-in network to file
+//        ./test --serve [-j <instances>] [-p <stages>] [-c <cpu instances>]
+//                       [<model file>]     daemon: classify input files named
+//                                          on stdin (see runtime.hpp)
+//        ./test --regress <list file> [-j <instances>] [-c <cpu instances>]
+//                       [<model file>]     accuracy + throughput over list of
+//                                          images (see regression.hpp),
+//                                          default: CPU engine on all cores
+//        ./test --perf-model [--json] [--pe <N>] [--clock <MHz>]
+//                       [--bus <bytes>] [<model file>]
+//                                          estimated cycles, MACs, DRAM
+//                                          traffic per layer for the given
+//                                          architecture (see perf_model.hpp)
+//        ./test --autotune [--json] [--util <fraction>] [--dsp <N>]
+//                       [--bram <N>] [--lut <N>] [--top <N>] [<model file>]
+//                                          best N_PE, cache sizes, HLS
+//                                          directives for the xc7z045
+//                                          (default: 100%), see autotune.hpp
+//        ./test --dram-trace <trace file> [<any of the above>]
+//                                          record all DRAM accesses of the
+//                                          C-Sim (see dram_trace.hpp)
+//        ./test --profile <file.csv|.json> [<any of the above>]
+//                                          wall-clock, GOPS, Bytes per layer
+//                                          of C-Sim + CPU engine, table at
+//                                          exit (see layer_profile.hpp)
+//        ./test --analyze-dram-trace <trace file> [<model file>]
+//                                          bytes, runs, bursts, re-reads
+//                                          per layer of a recorded trace
+//        ./test --decode-log <log trace>   print binary log of a -DEBUG
+//                                          build (see log_trace.hpp)
+int main(int argc, char **argv) {
   LOG_LEVEL = 0;
 
   // ==============
@@ -40,12 +71,139 @@ int main() {
     return -1;
   };
 
+  // Record DRAM Accesses / Profile Layers (all following fpga_top() runs),
+  // then continue with the remaining arguments
+  while (argc >= 3 && (std::string(argv[1]) == "--dram-trace" ||
+                       std::string(argv[1]) == "--profile")) {
+    if (std::string(argv[1]) == "--dram-trace" && !dramTraceOpen(argv[2]))
+      return -1;
+    if (std::string(argv[1]) == "--profile" && !layerProfileOpen(argv[2]))
+      return -1;
+    argv[2] = argv[0];
+    argv += 2;
+    argc -= 2;
+  }
+  if (argc == 3 && std::string(argv[1]) == "--decode-log")
+    return (decodeLogTrace(argv[2], stdout) < 0) ? -1 : 0;
+  if (argc >= 3 && std::string(argv[1]) == "--analyze-dram-trace") {
+    network_t *net = (argc > 3) ? loadModelFile(argv[3]) : get_network_config();
+    return (analyzeDRAMTrace(argv[2], net, stdout) < 0) ? -1 : 0;
+  }
+
   // =================
   // = Setup Network =
   // =================
+  // Load Network Config + Weights from Model File (see model_file.hpp), or
   // Generate + Load Network Config from network.hpp/network.cpp
+  bool serve = (argc >= 2 && std::string(argv[1]) == "--serve");
+  bool regress = (argc >= 3 && std::string(argv[1]) == "--regress");
+  if (serve || regress) {
+    // Daemon / Regression Mode: keep stdout for responses / report, send all
+    // other messages to stderr
+    FILE *responses = fdopen(dup(STDOUT_FILENO), "w");
+    fflush(stdout);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    // -j: accelerator instances, -p: layer pipeline stages,
+    // -c: CPU fallback instances (see cpu_engine.hpp)
+    int num_instances = -1;
+    int num_stages = 1;
+    int num_cpu_instances = -1;
+    int arg = serve ? 2 : 3;
+    while (argc >= arg + 2 && (std::string(argv[arg]) == "-j" ||
+                               std::string(argv[arg]) == "-p" ||
+                               std::string(argv[arg]) == "-c")) {
+      if (std::string(argv[arg]) == "-j") num_instances = atoi(argv[arg + 1]);
+      if (std::string(argv[arg]) == "-p") num_stages = atoi(argv[arg + 1]);
+      if (std::string(argv[arg]) == "-c")
+        num_cpu_instances = atoi(argv[arg + 1]);
+      arg += 2;
+    }
+    if (num_instances < 0 && num_cpu_instances < 0 && regress)
+      num_cpu_instances = std::max(1u, std::thread::hardware_concurrency());
+    if (num_instances < 0)
+      num_instances = (num_cpu_instances > 0) ? 0 : NUM_ACCELERATOR_INSTANCES;
+    network_t *net =
+        (argc > arg) ? loadModelFile(argv[arg]) : get_network_config();
+    AcceleratorRuntime runtime(net, NUM_TOPK_ON_FPGA, num_instances,
+                               num_stages, num_cpu_instances);
+    if (regress) {
+      int num_done = runRegression(runtime, argv[2], responses);
+      runtime.printUtilization(stderr);
+      return (num_done < 0) ? -1 : 0;
+    }
+    int num_served = runtime.serve(STDIN_FILENO, responses);
+    fprintf(stderr, "CPU: Served %d images.\n", num_served);
+    runtime.printUtilization(stderr);
+    return 0;
+  }
+
+  if (argc >= 2 && std::string(argv[1]) == "--perf-model") {
+    perf_arch_t arch = defaultPerfArch();
+    bool json = false;
+    int arg = 2;
+    while (argc > arg && std::string(argv[arg]).compare(0, 2, "--") == 0) {
+      std::string opt(argv[arg]);
+      if (opt == "--json") {
+        json = true;
+        arg += 1;
+        continue;
+      }
+      if (argc < arg + 2) break;
+      if (opt == "--pe") arch.n_pe = atoi(argv[arg + 1]);
+      if (opt == "--clock") arch.clock_mhz = atof(argv[arg + 1]);
+      if (opt == "--bus") arch.bus_bytes = atoi(argv[arg + 1]);
+      arg += 2;
+    }
+    network_t *net =
+        (argc > arg) ? loadModelFile(argv[arg]) : get_network_config();
+    if (json)
+      printPerformanceJSON(net, arch, stdout);
+    else
+      printPerformanceTable(net, arch, stdout);
+    return 0;
+  }
+
+  if (argc >= 2 && std::string(argv[1]) == "--autotune") {
+    tune_budget_t budget = xc7z045Budget(1.0);
+    bool json = false;
+    int num_shown = 10;
+    int arg = 2;
+    while (argc > arg && std::string(argv[arg]).compare(0, 2, "--") == 0) {
+      std::string opt(argv[arg]);
+      if (opt == "--json") {
+        json = true;
+        arg += 1;
+        continue;
+      }
+      if (argc < arg + 2) break;
+      if (opt == "--util") budget = xc7z045Budget(atof(argv[arg + 1]));
+      if (opt == "--dsp") budget.dsp = atoi(argv[arg + 1]);
+      if (opt == "--bram") budget.bram18k = atoi(argv[arg + 1]);
+      if (opt == "--lut") budget.lut = atoi(argv[arg + 1]);
+      if (opt == "--top") num_shown = atoi(argv[arg + 1]);
+      arg += 2;
+    }
+    network_t *net =
+        (argc > arg) ? loadModelFile(argv[arg], false) : get_network_config();
+    std::vector<tune_result_t> results = autotune(net, budget);
+    if (json)
+      printAutotuneJSON(net, budget, results, num_shown, stdout);
+    else
+      printAutotuneReport(net, budget, results, num_shown, stdout);
+    return results.empty() ? -1 : 0;
+  }
+
   network_t *net_CPU;
-  net_CPU = get_network_config();
+  if (argc == 2) {
+    net_CPU = loadModelFile(argv[1]);
+  } else {
+    net_CPU = get_network_config();
+    if (!checkNetworkLimits(net_CPU)) return -1;
+  }
+  if (argc == 3 && std::string(argv[1]) == "--save-model") {
+    saveModelFile(net_CPU, argv[2]);
+    return 0;
+  }
 
   // Assert that layer_t fits into a multiple of bus transactions:
   // ONLY NECESSARY IF WE CAN MAP LAYER_T TRANSFER ONTO BUS_T AXI MASTER
@@ -60,11 +218,13 @@ int main() {
   // ==========================
   // Allocate Shared Memory for Config, Weights, Data.
   // Copy Layer Config + Weights to FPGA.
-  setup_FPGA(net_CPU);
+  // (num_topk = 0: read back all class scores for the comparison with the
+  // CPU Engine below, the Top-K stage is covered by the unit tests)
+  AcceleratorRuntime runtime(net_CPU, 0);
 
-  // ===========================
-  // = Load + Copy Input Image =
-  // ===========================
+  // ====================
+  // = Load Input Image =
+  // ====================
   /* Structured: generate_structured_input_image(input_image,win,hin,chin);
    PseudoRandom: generate_random_input_image(input_image, win, hin, chin, 1);
    ReallyRandom: generate_random_input_image(input_image, win, hin, chin -1);
@@ -84,50 +244,74 @@ int main() {
   // Load Input Image
   load_prepared_input_image(input_image, "./indata.bin", win, hin, chin);
 
-  // Copy onto FPGA
-  copy_input_image_to_FPGA(net_CPU, input_image);
-
-  // ============================
-  // = Execute FPGA Accelerator =
-  // ============================
-  int weights_offset =
-      ((long)SHARED_DRAM_WEIGHTS - (long)SHARED_DRAM) / sizeof(data_t);
-  int input_offset =
-      ((long)SHARED_DRAM_DATA - (long)SHARED_DRAM) / sizeof(data_t);
-  printf("SHARED_DRAM is at address: %lu\n", (long)SHARED_DRAM);
-  fpga_top((data_t *)SHARED_DRAM, net_CPU->num_layers, weights_offset,
-           input_offset);
-
-  LOG_LEVEL = 0;
-
-  // ===============================
-  // = Copy Results back from FPGA =
-  // ===============================
+  // ====================================================
+  // = Execute FPGA Accelerator, Copy Results + Softmax =
+  // ====================================================
   int ch_out = net_CPU->layers[net_CPU->num_layers - 1].channels_out;
   data_t *results = (data_t *)malloc(ch_out * sizeof(data_t));
-  copy_results_from_FPGA(net_CPU, results, ch_out);
-
-  // =====================
-  // = Calculate Softmax =
-  // =====================
   std::vector<std::pair<data_t, int> > probabilities(ch_out);
-  calculate_softmax(net_CPU, results, probabilities);
+  runtime.classify(input_image, results, probabilities);
+
+  LOG_LEVEL = 0;
+
+  // Where did the Iterations go? (see perf_counters.hpp)
+  printf("\n");
+  runtime.printPerfCounters(stdout);
 
   // ==================
   // = Report Results =
   // ==================
+  int num_reported = std::min(5, (int)probabilities.size());
   printf("\nResult (top-5):\n====================\n");
-  for (int i = 0; i < std::min(5, ch_out); i++) {
+  for (int i = 0; i < num_reported; i++) {
     printf("    %5.2f%%: class %3d (output %6.2f)\n",
            100 * probabilities[i].first, probabilities[i].second,
            results[probabilities[i].second]);
   }
 
+  // ====================================
+  // = Compare with CPU Engine (Golden) =
+  // ====================================
+  // Classify same Image with optimized CPU Engine (see cpu_engine.hpp),
+  // all raw FPGA class scores must match: |a - b| <= 1e-4 * max(|a|, |b|, 1)
+  CPUEngine cpu_engine(net_CPU);
+  std::vector<data_t> cpu_data(get_data_slot_size(net_CPU));
+  std::vector<data_t> cpu_results(ch_out);
+  std::vector<std::pair<data_t, int> > cpu_probabilities(ch_out);
+  memcpy(cpu_data.data(), input_image, win * hin * chin * sizeof(data_t));
+  std::chrono::steady_clock::time_point cpu_start =
+      std::chrono::steady_clock::now();
+  cpu_engine.run(cpu_data.data(), 0);
+  double cpu_ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - cpu_start)
+                      .count();
+  memcpy(cpu_results.data(), cpu_data.data(), ch_out * sizeof(data_t));
+  calculate_softmax(net_CPU, cpu_results.data(), cpu_probabilities);
+  // (compare scores of all classes, not class ids: classes may tie)
+  data_t max_deviation = 0;
+  for (int i = 0; i < ch_out; i++) {
+    data_t a = results[i], b = cpu_results[i];
+    data_t scale = std::max(std::max((data_t)fabs(a), (data_t)fabs(b)),
+                            (data_t)1.0f);
+    max_deviation = std::max(max_deviation, (data_t)fabs(a - b) / scale);
+  }
+  bool cpu_agrees = (max_deviation <= 1e-4f);
+  printf("\nCPU Engine (%s, %.2f ms): top-1 class %3d, max. rel. deviation "
+         "%.2e %s\n",
+         cpu_engine.isaName(), cpu_ms, cpu_probabilities[0].second,
+         max_deviation, cpu_agrees ? "(agrees)" : "(MISMATCH)");
+
+#if defined(EBUG) && !defined(LOG_PRINTF)
+  // Debug Build: write Log Trace (decode with ./test --decode-log <file>)
+  logTraceDump(LOG_TRACE_FILE);
+#endif
+
   // ====================
   // = TestBench Result =
   // ====================
   // Check if output is AS EXPECTED (+- 0.1%) (defined in network.hpp)
-  if (fabs(100 * probabilities[0].first - TEST_RESULT_EXPECTED) < 0.1) {
+  if (fabs(100 * probabilities[0].first - TEST_RESULT_EXPECTED) < 0.1 &&
+      cpu_agrees) {
     printf("\nTestBench Result: SUCCESS\n");
     return 0;
   } else {
@@ -151,11 +335,22 @@ int main() {
 //     |    weights   |  configsize
 //     |              |  ...
 //     |______________|  configsize + weightsize - 1
-//     |     data     |  configsize + weightsize
+//     |  data slot 0 |  configsize + weightsize
 //     |  in + output |  ...
-//     |______________|  configsize + weightsize + datasize - 1
+//     |______________|
+//     |  data slot 1 |  configsize + weightsize + datasize
+//     |      ...     |  (one data section per job slot, see runtime.hpp)
+//     |______________|  configsize + weightsize + num_slots * datasize - 1
+//     |  perf stats  |  one stats section per job slot (per-layer counters)
+//     |______________|
 //
-void allocate_FPGA_memory(network_t *net_CPU) {
+int get_data_slot_size(network_t *net_CPU) {
+  // Data Section of one Job Slot (floats), aligned like the activations
+  int align = std::max(1, (int)(net_CPU->mem_alignment / sizeof(data_t)));
+  return (net_CPU->total_pixel_mem + align - 1) / align * align;
+}
+
+shared_dram_t allocate_FPGA_memory(network_t *net_CPU, int num_slots) {
   // For Simulation purposes, allocate space on Heap
   // For actual HW Implementation, set fixed memory addresses in Shared DRAM
 
@@ -163,43 +358,61 @@ void allocate_FPGA_memory(network_t *net_CPU) {
   // int configsize = net_CPU->num_layers * (sizeof(layer_t));
   int configsize = net_CPU->num_layers * (NUM_FLOATS_PER_LAYER * sizeof(float));
   int weightsize = net_CPU->num_weights * sizeof(data_t);
-  int datasize = net_CPU->total_pixel_mem * sizeof(data_t);
+  int datasize = get_data_slot_size(net_CPU) * sizeof(data_t);
 
   // Round memory areas to 32-bit boundaries (4 bytes)
   configsize = std::ceil(configsize / 4.0) * 4;
   weightsize = std::ceil(weightsize / 4.0) * 4;
   datasize = std::ceil(datasize / 4.0) * 4;
+  int statssize = net_CPU->num_layers * NUM_PERF_COUNTERS * sizeof(data_t);
 
-  int total_size = configsize + weightsize + datasize;
+  int total_size =
+      configsize + weightsize + num_slots * (datasize + statssize);
 
   // Memory Allocation
-  SHARED_DRAM = (char *)malloc(configsize + weightsize + datasize);
+  shared_dram_t dram;
+  dram.base = (char *)malloc(total_size);
 
   // Pointer Redirection
-  SHARED_DRAM_LAYER_CONFIG = (float *)(SHARED_DRAM + 0);
-  SHARED_DRAM_WEIGHTS = (data_t *)(SHARED_DRAM + configsize);
-  SHARED_DRAM_DATA = (data_t *)(SHARED_DRAM + configsize + weightsize);
+  dram.layer_config = (float *)(dram.base + 0);
+  dram.weights = (data_t *)(dram.base + configsize);
+  dram.data = (data_t *)(dram.base + configsize + weightsize);
+  dram.data_slot_size = datasize / sizeof(data_t);
+  dram.num_slots = num_slots;
+  dram.stats = dram.data + num_slots * dram.data_slot_size;
+  dram.stats_slot_size = statssize / sizeof(data_t);
+  memset(dram.stats, 0, num_slots * statssize);
 
   // Debug: Infos about Memory Regions
   printf("CPU: FPGA DRAM Memory Allocation:\n");
-  printf("     Bytes allocated: %dB (config) + %dKB (weights) + %dKB (data)\n",
-         configsize, weightsize / 1024, datasize / 1024);
-  printf("     region: %lu – %lu\n", (long)SHARED_DRAM,
-         (long)(SHARED_DRAM + total_size));
-
-  if (DRAM_DEPTH != total_size / sizeof(data_t)) {
+  printf("     Bytes allocated: %dB (config) + %dKB (weights) + %d x %dKB "
+         "(data) + %d x %dB (stats)\n", configsize, weightsize / 1024,
+         num_slots, datasize / 1024, num_slots, statssize);
+  printf("     region: %lu – %lu\n", (long)dram.base,
+         (long)(dram.base + total_size));
+
+  // DRAM_DEPTH (network.hpp) is the upper limit for all loadable models
+  // (exact for the built-in network, checked against netDramDepth()),
+  // larger model files need a build with their layer table in network.hpp
+  // (more job slots than NUM_JOB_SLOTS: only C/RTL Co-Simulation is affected)
+  if (DRAM_DEPTH < total_size / sizeof(data_t)) {
     printf(
-        "\n\n!! ERROR !!\n\n Please set variable DRAM_DEPTH = %d "
-        "in network.hpp\n\n",
-        (int)(total_size / sizeof(data_t)));
-    exit(-1);
+        "\n\n!! %s !!\n\n Model needs %d floats, DRAM_DEPTH = %d: "
+        "set DRAM_DEPTH + NET_LAYERS in network.hpp\n\n",
+        (num_slots > NUM_JOB_SLOTS) ? "WARNING" : "ERROR",
+        (int)(total_size / sizeof(data_t)), DRAM_DEPTH);
+    if (num_slots <= NUM_JOB_SLOTS) exit(-1);
+  } else if (DRAM_DEPTH != total_size / sizeof(data_t)) {
+    printf("     (uses %d of DRAM_DEPTH = %d floats)\n",
+           (int)(total_size / sizeof(data_t)), DRAM_DEPTH);
   }
+  return dram;
 }
 
 // =====================================================
 // = Copy Layer Config + Weights to FPGA (shared DRAM) =
 // =====================================================
-void copy_config_to_FPGA(network_t *net_CPU) {
+void copy_config_to_FPGA(network_t *net_CPU, shared_dram_t &dram) {
   // int configsize = net_CPU->num_layers * sizeof(layer_t);
   int configsize = net_CPU->num_layers * (NUM_FLOATS_PER_LAYER * sizeof(float));
   int weightsize = net_CPU->num_weights * sizeof(data_t);
@@ -209,14 +422,14 @@ void copy_config_to_FPGA(network_t *net_CPU) {
   printf("     %dB (config) + %dKB (weights)\n", configsize, weightsize / 1024);
 
   // Copy Layer Config:
-  // memcpy(SHARED_DRAM_LAYER_CONFIG, net_CPU->layers, configsize);
+  // memcpy(dram.layer_config, net_CPU->layers, configsize);
   for (int l = 0; l < net_CPU->num_layers; l++) {
     layer_to_floats(net_CPU->layers[l],
-                    &SHARED_DRAM_LAYER_CONFIG[l * NUM_FLOATS_PER_LAYER]);
+                    &dram.layer_config[l * NUM_FLOATS_PER_LAYER]);
   }
 
-  // Copy Weights:
-  memcpy(SHARED_DRAM_WEIGHTS, net_CPU->weights, weightsize);
+  // Copy Weights (once, shared by all accelerator instances):
+  memcpy(dram.weights, net_CPU->weights, weightsize);
 }
 
 // ======================================
@@ -244,7 +457,8 @@ void load_prepared_input_image(data_t *input_image, const char *filename,
 // ==========================================
 // = Copy Input Image to FPGA (shared DRAM) =
 // ==========================================
-void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image) {
+void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image,
+                              data_t *data_section) {
   // Input Data goes into Layer 0:
   int win = net_CPU->layers[0].width;
   int hin = net_CPU->layers[0].height;
@@ -255,7 +469,7 @@ void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image) {
   printf("CPU: Copy Input Data: %dKB (input image)\n", input_img_size / 1024);
 
   // Copy Input Data:
-  memcpy(SHARED_DRAM_DATA, image, input_img_size);
+  memcpy(data_section, image, input_img_size);
 }
 
 // =============================================
@@ -264,7 +478,8 @@ void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image) {
 // Assumption: Last Layer reduces data to dimensions 1x1xch_out (global pool)
 // Assumption: Output Data is written back to where initial image was placed
 // data_t *results: Pointer to data_t array with enough space to hold results
-void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out) {
+void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out,
+                            data_t *data_section) {
   // Verify that last layer reduces spatial dimensions to 1x1:
   assert(net_CPU->layers[net_CPU->num_layers - 1].pool == POOL_GLOBAL);
 
@@ -275,7 +490,92 @@ void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out) {
   printf("CPU: Copy Results from FPGA DRAM: %d Bytes\n", result_size);
 
   // Copy Result Data:
-  memcpy(results, SHARED_DRAM_DATA + result_offset, result_size);
+  memcpy(results, data_section + result_offset, result_size);
+}
+
+// ===================================================
+// = Copy Top-K Results back from FPGA (shared DRAM) =
+// ===================================================
+// FPGA wrote k (class, score) pairs + softmax normalizer to beginning of DATA
+// section (see MemoryController::writeBackTopK), sorted by descending score.
+// results[]: scores of the top-k classes (all other classes are set to 0)
+// probabilities: resized to k entries (probability, class), sorted
+void copy_topk_results_from_FPGA(
+    network_t *net_CPU, data_t *results,
+    std::vector<std::pair<data_t, int> > &probabilities, int k,
+    data_t *data_section) {
+  // Verify that last layer reduces spatial dimensions to 1x1:
+  assert(net_CPU->layers[net_CPU->num_layers - 1].pool == POOL_GLOBAL);
+
+  int ch_out = net_CPU->layers[net_CPU->num_layers - 1].channels_out;
+  k = std::min(k, std::min(ch_out, MAX_TOPK));
+  int result_size = (2 * k + 1) * sizeof(data_t);
+
+  printf("CPU: Copy Top-%d Results from FPGA DRAM: %d Bytes\n", k,
+         result_size);
+
+  // Copy Result Data:
+  data_t *topk = (data_t *)malloc(result_size);
+  memcpy(topk, data_section, result_size);
+
+  // Decode (class, score) pairs, calculate softmax probabilities
+  // [ p_i = e^{r_i - r_max} / (\sum(e^{r_j - r_max})) ]
+  data_t maxresult = topk[1];
+  data_t expsum = topk[2 * k];
+  for (int i = 0; i < ch_out; i++) results[i] = 0;
+  probabilities.resize(k);
+  for (int i = 0; i < k; i++) {
+    int classid = (int)topk[2 * i];
+    results[classid] = topk[2 * i + 1];
+    probabilities[i] = std::pair<data_t, int>(
+        exp(results[classid] - maxresult) / expsum, classid);
+  }
+  DBG("sum of exponentials: %f\n", expsum);
+
+  free(topk);
+}
+
+// ======================================================
+// = Decode + Print Performance Counters (shared DRAM) =
+// ======================================================
+// FPGA wrote NUM_PERF_COUNTERS uint32 (in floats) per executed layer to the
+// stats section (see MemoryController::writeBackPerfCounters). Layers not
+// executed on the FPGA (CPU engine) are all zero. Cycles come from the cycle
+// timestamp of fpga_top (C-Sim: one per loop iteration), shown next to the
+// cycles of the analytical model (perf_model.hpp).
+void print_FPGA_perf_counters(network_t *net_CPU, data_t *stats_section,
+                              FILE *out) {
+  perf_arch_t arch = defaultPerfArch();
+  union { float f; unsigned int i; } u;
+  fprintf(out, "FPGA Performance Counters (per layer):\n");
+  fprintf(out, "%6s: %11s %7s %11s %7s %9s %9s %12s\n", "layer", "cycles",
+          "stall", "iterations", "MAC", "rd words", "wr words",
+          "model cycles");
+  double total_cycles = 0, total_iterations = 0;
+  for (int l = 0; l < net_CPU->num_layers; l++) {
+    layer_t *layer = &net_CPU->layers[l];
+    double c[NUM_PERF_COUNTERS];
+    for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+      u.f = stats_section[l * NUM_PERF_COUNTERS + i];
+      c[i] = u.i;
+    }
+    double model_cycles = estimateLayerPerformance(layer, arch).cycles;
+    if (c[PERF_ITERATIONS] == 0) {
+      fprintf(out, "%6s: %11s %47s %12.0f\n", layer->name, "-", "",
+              model_cycles);
+      continue;
+    }
+    fprintf(out, "%6s: %11.0f %6.1f%% %11.0f %6.1f%% %9.0f %9.0f %12.0f\n",
+            layer->name, c[PERF_CYCLES],
+            100 * c[PERF_STALL_CYCLES] / std::max(c[PERF_CYCLES], 1.0),
+            c[PERF_ITERATIONS],
+            100 * c[PERF_MAC_ITERATIONS] / c[PERF_ITERATIONS],
+            c[PERF_WORDS_READ], c[PERF_WORDS_WRITTEN], model_cycles);
+    total_cycles += c[PERF_CYCLES];
+    total_iterations += c[PERF_ITERATIONS];
+  }
+  fprintf(out, "%6s: %11.0f %7s %11.0f\n", "total", total_cycles, "",
+          total_iterations);
 }
 
 // ===========================================
@@ -283,7 +583,8 @@ void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out) {
 // ===========================================
 void calculate_softmax(network_t *net_CPU, data_t *results,
                        std::vector<std::pair<data_t, int> > &probabilities) {
-  // First, finish Global AVG Pooling (FPGA does just accumulation, no division)
+  // First, finish Global AVG Pooling (unless FPGA already divided the
+  // accumulated sums, see GPOOL_AVERAGE_ON_FPGA in fpga_top.hpp)
   // Then, subtract maximum to avoid Numerical Issues in Exponentiation
   // (as done by CAFFE in caffe/include/caffe/layers/softmax_layer.hpp)
   // Then, calculate actual Softmax [ p_i = e^{r_i} / (\sum(e^{r_i})) ]
@@ -297,7 +598,7 @@ void calculate_softmax(network_t *net_CPU, data_t *results,
   data_t maxresult = 0;
   for (int i = 0; i < ch_out; i++) {
     // Average over spatial output dimensions
-    results[i] /= num_output_pixels;
+    if (!GPOOL_AVERAGE_ON_FPGA) results[i] /= num_output_pixels;
     // Find maximum result
     maxresult = std::max(maxresult, results[i]);
     DBG("  %6.2f\n", results[i]);
@@ -402,15 +703,16 @@ void do_preprocess(data_t *input_image, int win, int hin, int chin) {
 // =======================================================================
 // = Setup Network (Allocate Shared Memory, Copy Layer Config + Weights) =
 // =======================================================================
-void setup_FPGA(network_t *net_CPU) {
+shared_dram_t setup_FPGA(network_t *net_CPU, int num_slots) {
   // Print Network Config
   printf("\n\nCPU: Network Setup:\n=====================\n\n");
   print_layers(net_CPU);
   printf("\n");
 
   // Setup FPGA DRAM Memory (Config, Weights, Data Sections)
-  allocate_FPGA_memory(net_CPU);
+  shared_dram_t dram = allocate_FPGA_memory(net_CPU, num_slots);
 
   // Copy Network Config (Layer Config, Weights)
-  copy_config_to_FPGA(net_CPU);
+  copy_config_to_FPGA(net_CPU, dram);
+  return dram;
 }
@@ -21,12 +21,14 @@
 #include <cmath>      // fabs, fmax, ...
 #include <vector>     // std::vector for softmax calculation
 #include <algorithm>  // sort, reverse (on std::vector)
+#include <string>     // command line arguments
 
 // ===========================
 // = CNN Network Definitions =
 // ===========================
 #include "network.hpp"    // load before netconfig.hpp for bit-width calculation
 #include "netconfig.hpp"  // network config (layer_t, network_t)
+#include "model_file.hpp"  // load / save network + weights as single file
 
 // ==============
 // = Unit Tests =
@@ -37,16 +39,55 @@
 // = FPGA Algorithm =
 // ==================
 #include "fpga_top.hpp"  // top-level FPGA module
+#include "perf_counters.hpp"  // per-layer counters written by fpga_top
+#include "memory_controller.hpp"  // shared DRAM interface (DRAM_DEPTH)
+
+// ===========================
+// = Host-Side Configuration =
+// ===========================
+// Number of best classes selected on FPGA (Top-K stage after global pooling)
+// 0 = read back all class scores and compute full softmax on CPU
+const int NUM_TOPK_ON_FPGA = 5;
+// Number of Accelerator Instances (fpga_top) used by the runtime
+// (C-Simulation: one device thread per instance)
+const int NUM_ACCELERATOR_INSTANCES = 1;
+
+// ==============================
+// = Shared DRAM Memory Regions =
+// ==============================
+// Memory shared between CPU and FPGA (set up by allocate_FPGA_memory),
+// no global state: several accelerator instances may share one region
+struct shared_dram_t {
+  char *base;            // start of shared DRAM (SHARED_DRAM port of fpga_top)
+  float *layer_config;   // layer_t structs as float arrays
+  data_t *weights;       // read-only, shared by all accelerator instances
+  data_t *data;          // data section of job slot 0
+  int data_slot_size;    // floats per data section
+  int num_slots;         // data sections (job slots), slot i at data + i * size
+  data_t *stats;         // performance counters of slot i at stats + i * size
+  int stats_slot_size;   // floats per stats section (NUM_PERF_COUNTERS/layer)
+};
 
 // ===========================================
 // = CPU-Side Functions for SqueezeNetOnFPGA =
 // ===========================================
-void allocate_FPGA_memory(network_t *net_CPU);
-void copy_config_to_FPGA(network_t *net_CPU);
+int get_data_slot_size(network_t *net_CPU);
+shared_dram_t allocate_FPGA_memory(network_t *net_CPU, int num_slots = 1);
+void copy_config_to_FPGA(network_t *net_CPU, shared_dram_t &dram);
 void load_prepared_input_image(data_t *input_image, const char *filename,
                                int win, int hin, int chin);
-void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image);
-void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out);
+// (data_section: data section of job slot in shared DRAM)
+void copy_input_image_to_FPGA(network_t *net_CPU, data_t *image,
+                              data_t *data_section);
+void copy_results_from_FPGA(network_t *net_CPU, data_t *results, int ch_out,
+                            data_t *data_section);
+void copy_topk_results_from_FPGA(
+    network_t *net_CPU, data_t *results,
+    std::vector<std::pair<data_t, int> > &probabilities, int k,
+    data_t *data_section);
+// (stats_section: performance counters of job slot, see perf_counters.hpp)
+void print_FPGA_perf_counters(network_t *net_CPU, data_t *stats_section,
+                              FILE *out);
 void calculate_softmax(network_t *net_CPU, data_t *results,
                        std::vector<std::pair<data_t, int> > &probabilities);
 void generate_structured_input_image(data_t *input_image, int win, int hin,
@@ -56,7 +97,7 @@ void generate_random_input_image(data_t *input_image, int win, int hin,
 void load_image_file(data_t *input_image, const char *filename, int win,
                      int hin, int chin);
 void do_preprocess(data_t *input_image, int win, int hin, int chin);
-void setup_FPGA(network_t *net_CPU);
-int main();
+shared_dram_t setup_FPGA(network_t *net_CPU, int num_slots = 1);
+int main(int argc, char **argv);
 
 #endif
@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  dram_trace.cpp
+//
+//  DRAM Access Tracer (C-Simulation) + Burst-Efficiency Analyzer
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "dram_trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// =====================
+// = DRAM Access Trace =
+// =====================
+bool dram_trace_enabled = false;
+
+static FILE *trace_file = NULL;
+static std::mutex trace_mutex;
+static std::atomic<int> trace_num_instances(0);
+
+// Per Device Thread: current layer + current run of contiguous words per
+// access kind (not yet written; AXI reads + writes are independent streams)
+struct trace_state_t {
+  int instance;
+  int layer;
+  dram_trace_record_t runs[NUM_DRAM_ACCESS_KINDS];
+  trace_state_t() : instance(trace_num_instances++), layer(0) {
+    for (int k = 0; k < NUM_DRAM_ACCESS_KINDS; k++) runs[k].length = 0;
+  }
+};
+static thread_local trace_state_t trace_state;
+
+bool dramTraceOpen(const char *filename) {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_file = fopen(filename, "wb");
+  if (!trace_file) {
+    printf("ERROR: DRAM trace file %s could not be opened!\n", filename);
+    return false;
+  }
+  dram_trace_enabled = true;
+  return true;
+}
+
+void dramTraceClose() {
+  dramTraceFlush();
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  dram_trace_enabled = false;
+  if (trace_file) fclose(trace_file);
+  trace_file = NULL;
+}
+
+static void flushRun(dram_trace_record_t &run) {
+  if (run.length == 0) return;
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (trace_file) fwrite(&run, sizeof(run), 1, trace_file);
+  run.length = 0;
+}
+
+void dramTraceFlush() {
+  for (int k = 0; k < NUM_DRAM_ACCESS_KINDS; k++)
+    flushRun(trace_state.runs[k]);
+}
+
+void dramTraceLayer(int layer_id) {
+  dramTraceFlush();
+  trace_state.layer = layer_id;
+  dram_trace_record_t start = {(uint16_t)layer_id, DRAM_TRACE_LAYER_START,
+                               (uint8_t)trace_state.instance, 0, 0};
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (trace_file) fwrite(&start, sizeof(start), 1, trace_file);
+}
+
+void dramTraceAccess(dramaccess_t kind, long address, int num_words) {
+  dram_trace_record_t &run = trace_state.runs[kind];
+  // Extend current Run if contiguous, else write it + start a new one
+  if (run.length > 0 && run.address + run.length == address) {
+    run.length += num_words;
+    return;
+  }
+  flushRun(run);
+  run.layer = trace_state.layer;
+  run.kind = kind;
+  run.instance = trace_state.instance;
+  run.address = address;
+  run.length = num_words;
+}
+
+// ==========================
+// = Offline Trace Analyzer =
+// ==========================
+static const char *ACCESS_KIND_NAMES[NUM_DRAM_ACCESS_KINDS] = {
+    "weights rd", "pixels rd", "bypass rd", "output wr", "result wr",
+    "stats wr"};
+
+struct access_stats_t {
+  double words, runs, bursts, redundant_words;
+  double run_histogram[4];  // run length 1, 2-15, 16-255, >= 256 words
+};
+struct layer_stats_t {
+  int executions;
+  access_stats_t kinds[NUM_DRAM_ACCESS_KINDS];
+};
+typedef std::vector<std::pair<uint32_t, uint32_t> > intervals_t;
+struct instance_state_t {  // currently executed layer
+  int layer;
+  intervals_t reads[NUM_DRAM_ACCESS_KINDS];
+};
+
+// AXI Bursts for a Run: at most DRAM_MAX_BURST_BEATS words (bus = 1 word),
+// never across a 4 KB boundary
+static int numBursts(uint32_t address, uint32_t length) {
+  const uint32_t words_per_4k = 4096 / sizeof(data_t);
+  int bursts = 0;
+  while (length > 0) {
+    uint32_t to_boundary = words_per_4k - address % words_per_4k;
+    uint32_t beats = std::min(
+        length, std::min(to_boundary, (uint32_t)DRAM_MAX_BURST_BEATS));
+    address += beats;
+    length -= beats;
+    bursts++;
+  }
+  return bursts;
+}
+
+// Words read more than once: total length - length of union of intervals
+static double redundantWords(intervals_t &reads) {
+  std::sort(reads.begin(), reads.end());
+  double total = 0, covered = 0;
+  uint32_t end = 0;
+  for (size_t i = 0; i < reads.size(); i++) {
+    uint32_t a = reads[i].first, b = reads[i].first + reads[i].second;
+    total += reads[i].second;
+    if (i == 0 || a >= end) {
+      covered += b - a;
+      end = b;
+    } else if (b > end) {
+      covered += b - end;
+      end = b;
+    }
+  }
+  reads.clear();
+  return total - covered;
+}
+
+int analyzeDRAMTrace(const char *filename, network_t *net, FILE *out) {
+  FILE *in = fopen(filename, "rb");
+  if (!in) {
+    printf("ERROR: DRAM trace file %s could not be opened!\n", filename);
+    return -1;
+  }
+
+  // Collect Statistics per (Layer, Kind), Reads per Execution of a Layer
+  std::map<int, layer_stats_t> stats;
+  std::map<int, instance_state_t> instances;
+  dram_trace_record_t r;
+  int num_records = 0;
+  auto finishExecution = [&](instance_state_t &inst) {
+    for (int k = 0; k < NUM_DRAM_ACCESS_KINDS; k++)
+      stats[inst.layer].kinds[k].redundant_words +=
+          redundantWords(inst.reads[k]);
+  };
+  while (fread(&r, sizeof(r), 1, in) == 1) {
+    num_records++;
+    instance_state_t &inst = instances[r.instance];
+    if (r.kind == DRAM_TRACE_LAYER_START) {
+      finishExecution(inst);
+      inst.layer = r.layer;
+      stats[r.layer].executions++;
+      continue;
+    }
+    if (r.kind >= NUM_DRAM_ACCESS_KINDS) continue;
+    access_stats_t &s = stats[r.layer].kinds[r.kind];
+    s.words += r.length;
+    s.runs++;
+    s.bursts += numBursts(r.address, r.length);
+    s.run_histogram[(r.length >= 256) ? 3 : (r.length >= 16) ? 2
+                                          : (r.length >= 2) ? 1 : 0]++;
+    if (r.kind <= DRAM_BYPASS_READ)
+      inst.reads[r.kind].push_back(std::make_pair(r.address, r.length));
+  }
+  fclose(in);
+  for (std::map<int, instance_state_t>::iterator it = instances.begin();
+       it != instances.end(); it++)
+    finishExecution(it->second);
+
+  // Report (Bytes per Execution of the Layer)
+  fprintf(out, "DRAM Trace %s: %d records\n", filename, num_records);
+  fprintf(out, "%6s %-10s %9s %7s %9s %7s %7s   %-29s %9s\n", "layer",
+          "kind", "kB/exec", "runs", "words/run", "bursts", "beats/b",
+          "runs: 1 | 2-15 | 16-255 | 256+", "redundant");
+  double total_words = 0, total_bursts = 0, total_redundant = 0;
+  for (std::map<int, layer_stats_t>::iterator it = stats.begin();
+       it != stats.end(); it++) {
+    int layer = it->first, n = std::max(1, it->second.executions);
+    char name[NET_NAME_MAX_LEN + 1];
+    if (net && layer < net->num_layers)
+      snprintf(name, sizeof(name), "%s", net->layers[layer].name);
+    else
+      snprintf(name, sizeof(name), "%d", layer);
+    for (int k = 0; k < NUM_DRAM_ACCESS_KINDS; k++) {
+      access_stats_t &s = it->second.kinds[k];
+      if (s.runs == 0) continue;
+      fprintf(out,
+              "%6s %-10s %9.1f %7.0f %9.1f %7.0f %7.1f "
+              "%8.0f %6.0f %8.0f %6.0f %9.1f%%\n",
+              name, ACCESS_KIND_NAMES[k], s.words * sizeof(data_t) / 1024 / n,
+              s.runs / n, s.words / s.runs, s.bursts / n, s.words / s.bursts,
+              s.run_histogram[0] / n, s.run_histogram[1] / n,
+              s.run_histogram[2] / n, s.run_histogram[3] / n,
+              100 * s.redundant_words / s.words);
+      total_words += s.words;
+      total_bursts += s.bursts;
+      total_redundant += s.redundant_words;
+    }
+  }
+  if (total_bursts > 0)
+    fprintf(out,
+            "total: %.1f kB in %.0f bursts (%.1f of max. %d beats per "
+            "burst), %.1f%% redundant\n",
+            total_words * sizeof(data_t) / 1024, total_bursts,
+            total_words / total_bursts, DRAM_MAX_BURST_BEATS,
+            100 * total_redundant / total_words);
+  return num_records;
+}
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  dram_trace.hpp
+//
+//  DRAM Access Tracer (C-Simulation) + Burst-Efficiency Analyzer
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef DRAM_TRACE_HPP_92C4E7A1
+#define DRAM_TRACE_HPP_92C4E7A1
+
+#include <cstdio>
+#include <stdint.h>
+#include "network.hpp"  // load before netconfig.hpp for bit-width calculation
+#include "netconfig.hpp"
+
+// =====================
+// = DRAM Access Trace =
+// =====================
+// Every DRAM access of MemoryController is reported with DRAM_TRACE(). In
+// C-Simulation, after dramTraceOpen(), accesses are merged into runs of
+// contiguous words (same layer, kind, instance) and written as binary
+// records to the trace file. In synthesis the macros are empty.
+typedef enum {
+  DRAM_WEIGHTS_READ,  // loadNextWeight (weights + biases)
+  DRAM_PIXEL_READ,    // loadNextChannel (input feature map)
+  DRAM_BYPASS_READ,   // loadBypassPixel (residual connection)
+  DRAM_OUTPUT_WRITE,  // storeNextChannel (output feature map)
+  DRAM_RESULT_WRITE,  // writeBackResult, writeBackTopK
+  DRAM_STATS_WRITE,   // writeBackPerfCounters
+  NUM_DRAM_ACCESS_KINDS
+} dramaccess_t;
+
+// Trace File: sequence of records (host byte order, 12 Bytes each),
+// each execution of a layer starts with a DRAM_TRACE_LAYER_START record
+const uint8_t DRAM_TRACE_LAYER_START = 0xFF;
+struct dram_trace_record_t {
+  uint16_t layer;     // layer id
+  uint8_t kind;       // dramaccess_t (or DRAM_TRACE_LAYER_START)
+  uint8_t instance;   // accelerator instance (device thread)
+  uint32_t address;   // first word (offset from SHARED_DRAM)
+  uint32_t length;    // number of contiguous words
+};
+
+#ifndef __SYNTHESIS__
+extern bool dram_trace_enabled;
+bool dramTraceOpen(const char *filename);
+void dramTraceClose();
+void dramTraceLayer(int layer_id);
+void dramTraceAccess(dramaccess_t kind, long address, int num_words);
+void dramTraceFlush();
+
+#define DRAM_TRACE(kind, address, num_words)                           \
+  {                                                                    \
+    if (dram_trace_enabled) dramTraceAccess(kind, address, num_words); \
+  }
+#define DRAM_TRACE_LAYER(layer_id)                    \
+  {                                                   \
+    if (dram_trace_enabled) dramTraceLayer(layer_id); \
+  }
+#define DRAM_TRACE_FLUSH()                    \
+  {                                           \
+    if (dram_trace_enabled) dramTraceFlush(); \
+  }
+#else
+#define DRAM_TRACE(kind, address, num_words) \
+  {}
+#define DRAM_TRACE_LAYER(layer_id) \
+  {}
+#define DRAM_TRACE_FLUSH() \
+  {}
+#endif
+
+// ==========================
+// = Offline Trace Analyzer =
+// ==========================
+// Per layer and access kind: words moved, runs of contiguous words (mean
+// length, histogram), AXI bursts needed (max. DRAM_MAX_BURST_BEATS beats,
+// no 4 KB boundary crossing) and redundant re-reads (words read more than
+// once within one execution of a layer). NET (optional): layer names.
+// Returns number of records (-1: trace file could not be read).
+const int DRAM_MAX_BURST_BEATS = 256;
+int analyzeDRAMTrace(const char *filename, network_t *net, FILE *out);
+
+#endif /* end of include guard: DRAM_TRACE_HPP_92C4E7A1 */
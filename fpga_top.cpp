@@ -17,36 +17,187 @@
 #include "image_cache.hpp"
 #include "weights_cache.hpp"
 #include "output_cache.hpp"
+#include "pooling_cache.hpp"
 #include "processing_element.hpp"
+#include "layer_profile.hpp"
+
+// =================
+// = Layer Kernels =
+// =================
+// One fully specialized pipeline per layer variant (KERNEL, STRIDE, PAD):
+// stride-2 skipping, window size and border padding are resolved at
+// compile time instead of per pixel. fpga_top() dispatches once per layer.
+template <int KERNEL, int STRIDE, int PAD>
+static void processLayer(layer_t &layer, MemoryController *DRAM,
+                         ImageCache *ICache, WeightsCache *WCache,
+                         OutputCache *OCache, OutputCache *GPoolCache,
+                         PoolingCache *PCache, OutputCache *BCache,
+                         ProcessingElement *PE) {
+  PerfCounters &Stats = DRAM->perfCounters();
+  channel_t ch_out_per_group = layer.channels_out / layer.groups;
+  coordinate_t y, x;
+  channel_t ci, co;
+
+  // Load Weights from DRAM
+  WCache->loadFromDRAM(DRAM);
+
+  // Preload Row 0 + Pixel (1,0)
+  DRAM->setPixelLoadRow(0);
+  ICache->preloadRowFromDRAM(DRAM);
+  DRAM->setPixelLoadRow(1);
+  ICache->preloadPixelFromDRAM(DRAM);
+
+// Y Loop
+L_Y:
+  for (y = 0; y < layer.height; y++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_DIMENSION max=MAX_DIMENSION avg=AVG_DIMENSION
+    LOG("Y = %d:\n", (int)y);
+    LOG_LEVEL_INCR;
+
+  // X Loop
+  L_X:
+    for (x = 0; x < layer.width; x++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_DIMENSION max=MAX_DIMENSION avg=AVG_DIMENSION
+      LOG("X = %d:\n", (int)x);
+      LOG_LEVEL_INCR;
+
+      // Reset Output Cache
+      OCache->reset();
+
+      // Load Next Pixel (automatically checks #pixels left)
+      ICache->preloadPixelFromDRAM(DRAM);
+
+      // Stride-2 Skipping
+      if (STRIDE == 2 & (x % 2 | y % 2)) {
+        LOG("stride-2, skipping pixel\n");
+        LOG_LEVEL_DECR;
+        continue;
+      }
+      dimension_t y_out = (int)y / STRIDE;
+      dimension_t x_out = (int)x / STRIDE;
+
+      // Prefetch Bypass Pixel (residual connection, added before ReLU)
+      if (layer.has_bypass) DRAM->loadBypassPixel(y_out, x_out, BCache);
+
+    // Input Channel Loop
+    L_CH_IN:
+      for (ci = 0; ci < layer.channels_in; ci++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_CHANNELS_IN max=MAX_CHANNELS_IN \
+    avg=AVG_CHANNELS_IN
+//#pragma HLS pipeline
+
+        LOG("CI = %d:\n", (int)ci);
+        LOG_LEVEL_INCR;
+        P_startPEs: {
+          // Kick off PEs
+          LOG("Start PEs for Pixel(%d,%d), input ch %d, all ouput ch\n",
+              (int)y, (int)x, (int)ci);
+          LOG_LEVEL_INCR;
+          PE->processInputChannel<KERNEL, PAD>(y, x, ci);
+          Stats.countPEChannel(ch_out_per_group);
+          LOG_LEVEL_DECR;
+        }
+        LOG_LEVEL_DECR;
+      }  // end L_CH_IN. Pixel (Y,X) is finished.
+      LOG("All CI, CO done for pixel(%d,%d)\n", (int)y, (int)x);
+
+      // ===============
+      // = Postprocess =
+      // ===============
+      data_t raw, biased, rectified;
+
+      LOG("Postprocess Pixel(%d,%d)\n", (int)y, (int)x);
+      LOG_LEVEL_INCR;
+
+      // Select bias coefficients
+      WCache->setInputChannel(layer.channels_in);
+
+    L_POSTPROCESS:
+      for (co = 0; co < layer.channels_out; co++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_NUM_CHOUT max=MAX_NUM_CHOUT avg=AVG_NUM_CHOUT
+        LOG("Postprocess CO=%d:\n", (int)co);
+        LOG_LEVEL_INCR;
+
+#pragma HLS pipeline
+
+        // Read output channel from Cache
+        raw = OCache->getChannel(co);
+        // Add Bias
+        biased = raw + WCache->getOneWeight(co);
+        // Add Bypass (residual connection)
+        if (layer.has_bypass) biased += BCache->getChannel(co);
+        // Add ReLU
+        rectified = (biased < 0) ? 0.0f : biased;
+
+        LOG("raw: %8.2f > biased: %8.2f > rectified: %8.2f\n", raw, biased,
+            rectified);
+        // Write Back to Output Cache
+        OCache->setChannel(co, rectified);
+        // Accumulate for Global Pooling (if enabled)
+        if (layer.pool == POOL_GLOBAL) {
+          GPoolCache->accumulateChannel(co, rectified);
+        }
+        LOG_LEVEL_DECR;
+      }
+      Stats.countPostprocess(layer.channels_out);
+      LOG_LEVEL_DECR;
+
+      // Write Output Pixel to DRAM
+      // (not for Global Pooling: only GPoolCache is needed by the CPU)
+      // (Max Pooling: PCache writes back each finished pooled pixel)
+      if (layer.pool == POOL_2x2S2 || layer.pool == POOL_3x3S2) {
+        PCache->poolPixel(y_out, x_out, OCache, DRAM);
+      } else if (layer.pool != POOL_GLOBAL) {
+        DRAM->writeBackOutputPixel(y_out, x_out, OCache);
+      }
+
+      LOG_LEVEL_DECR;
+    }
+    LOG_LEVEL_DECR;
+  }
+}
 
 // ==============
 // =  FPGA TOP  =
 // ==============
 void fpga_top(data_t *SHARED_DRAM, unsigned int num_layers,
-              unsigned int weights_offset, unsigned int input_offset) {
+              unsigned int weights_offset, unsigned int input_offset,
+              unsigned int num_topk, unsigned int first_layer,
+              unsigned int last_layer, unsigned int stats_offset,
+              volatile unsigned int *cycle_timestamp) {
 #pragma HLS INTERFACE m_axi depth = DRAM_DEPTH port = SHARED_DRAM offset = \
     direct bundle = memorybus
 #pragma HLS INTERFACE s_axilite port = num_layers bundle = axilite
 #pragma HLS INTERFACE s_axilite port = weights_offset bundle = axilite
 #pragma HLS INTERFACE s_axilite port = input_offset bundle = axilite
+#pragma HLS INTERFACE s_axilite port = num_topk bundle = axilite
+#pragma HLS INTERFACE s_axilite port = first_layer bundle = axilite
+#pragma HLS INTERFACE s_axilite port = last_layer bundle = axilite
+#pragma HLS INTERFACE s_axilite port = stats_offset bundle = axilite
+#pragma HLS INTERFACE ap_none port = cycle_timestamp
 #pragma HLS INTERFACE s_axilite port = return bundle = axilite
 
-  printf("FPGA TOP started.\n");
+#ifndef __SYNTHESIS__
+  if (!FPGA_TOP_QUIET) printf("FPGA TOP started.\n");
+#endif
   LOG_LEVEL_INCR;
 
   // =============================
   // = Module + Memory Instances =
   // =============================
-  MemoryController DRAM(SHARED_DRAM, weights_offset, input_offset);
+  MemoryController DRAM(SHARED_DRAM, weights_offset, input_offset,
+                        stats_offset);
+  PerfCounters &Stats = DRAM.perfCounters();
+  Stats.setCycleTimestamp(cycle_timestamp);
   layer_t layerConfig[MAX_NUM_LAYERS];
   ImageCache ICache;
   WeightsCache WCache;
   OutputCache OCache("OCache");
   OutputCache GPoolCache("GPoolCache");
+  PoolingCache PCache;
+  OutputCache BCache("BypassCache");
   ProcessingElement PE;  //[N_PE];
 
-  coordinate_t y, x;
-  channel_t ci, co;
   layerid_t layer_id;
 
   // Setup Processing Elements
@@ -64,12 +215,19 @@ void fpga_top(data_t *SHARED_DRAM, unsigned int num_layers,
   }
   LOG_LEVEL_DECR;
 
+  // Execute Range of Layers (default: all layers)
+  if (last_layer > num_layers - 1) last_layer = num_layers - 1;
+
 // Layer Loop
 L_LAYERS:
-  for (layer_id = 0; layer_id < num_layers; layer_id++) {
-#pragma HLS LOOP_TRIPCOUNT min=26 max=26 avg=26
+  for (layer_id = first_layer; layer_id <= (int)last_layer; layer_id++) {
+#pragma HLS LOOP_TRIPCOUNT min=MAX_NUM_LAYERS max=MAX_NUM_LAYERS \
+    avg=MAX_NUM_LAYERS
     LOG("Layer %d:\n", (int)layer_id);
     LOG_LEVEL_INCR;
+    LAYER_PROFILE_START();
+    // Reset Performance Counters, sample Cycle Timestamp for this Layer
+    Stats.startLayer();
 
     // Set Layer Configuration
     layer_t layer = layerConfig[layer_id];
@@ -80,130 +238,63 @@ L_LAYERS:
       WCache.setLayerConfig(layer);
       DRAM.setLayerConfig(layer);
       PE.setLayerConfig(layer);
+      PCache.setLayerConfig(layer);
     }
     LOG_LEVEL_DECR;
 
-    // Load Weights from DRAM
-    WCache.loadFromDRAM(&DRAM);
-
-    // Preload Row 0 + Pixel (1,0)
-    DRAM.setPixelLoadRow(0);
-    ICache.preloadRowFromDRAM(&DRAM);
-    DRAM.setPixelLoadRow(1);
-    ICache.preloadPixelFromDRAM(&DRAM);
-
-  // Y Loop
-  L_Y:
-    for (y = 0; y < layer.height; y++) {
-#pragma HLS LOOP_TRIPCOUNT min=8 max=256 avg=45
-      LOG("Y = %d:\n", (int)y);
-      LOG_LEVEL_INCR;
-
-    // X Loop
-    L_X:
-      for (x = 0; x < layer.width; x++) {
-#pragma HLS LOOP_TRIPCOUNT min=8 max=256 avg=45
-        LOG("X = %d:\n", (int)x);
-        LOG_LEVEL_INCR;
-
-        // Reset Output Cache
-        OCache.reset();
-
-        // Load Next Pixel (automatically checks #pixels left)
-        ICache.preloadPixelFromDRAM(&DRAM);
-
-        // Stride-2 Skipping
-        if (layer.stride == 2 & (x % 2 | y % 2)) {
-          LOG("stride-2, skipping pixel\n");
-          LOG_LEVEL_DECR;
-          continue;
-        }
-
-      // Input Channel Loop
-      L_CH_IN:
-        for (ci = 0; ci < layer.channels_in; ci++) {
-#pragma HLS LOOP_TRIPCOUNT min=3 max=1024 avg=237
-//#pragma HLS pipeline
-
-          LOG("CI = %d:\n", (int)ci);
-          LOG_LEVEL_INCR;
-          P_startPEs: {
-            // Kick off PEs
-            LOG("Start PEs for Pixel(%d,%d), input ch %d, all ouput ch\n",
-                (int)y, (int)x, (int)ci);
-            LOG_LEVEL_INCR;
-            PE.processInputChannel(y, x, ci);
-            LOG_LEVEL_DECR;
-          }
-          LOG_LEVEL_DECR;
-        }  // end L_CH_IN. Pixel (Y,X) is finished.
-        LOG("All CI, CO done for pixel(%d,%d)\n", (int)y, (int)x);
-
-        // ===============
-        // = Postprocess =
-        // ===============
-        data_t raw, biased, rectified;
-
-        LOG("Postprocess Pixel(%d,%d)\n", (int)y, (int)x);
-        LOG_LEVEL_INCR;
-
-        // Select bias coefficients
-        WCache.setInputChannel(layer.channels_in);
-
-      L_POSTPROCESS:
-        for (co = 0; co < layer.channels_out; co++) {
-#pragma HLS LOOP_TRIPCOUNT min=16 max=1024 avg=258
-          LOG("Postprocess CO=%d:\n", (int)co);
-          LOG_LEVEL_INCR;
-
-#pragma HLS pipeline
-
-          // Read output channel from Cache
-          raw = OCache.getChannel(co);
-          // Add Bias
-          biased = raw + WCache.getOneWeight(co);
-          // Add ReLU
-          rectified = (biased < 0) ? 0.0f : biased;
-
-          LOG("raw: %8.2f > biased: %8.2f > rectified: %8.2f\n", raw, biased,
-              rectified);
-          // Write Back to Output Cache
-          OCache.setChannel(co, rectified);
-          // Accumulate for Global Pooling (if enabled)
-          if (layer.pool == POOL_GLOBAL) {
-            GPoolCache.accumulateChannel(co, rectified);
-          }
-          LOG_LEVEL_DECR;
-        }
-        LOG_LEVEL_DECR;
-
-        // Write Output Pixel to DRAM
-        dimension_t y_out = (layer.stride == 2) ? (int)y / 2 : (int)y;
-        dimension_t x_out = (layer.stride == 2) ? (int)x / 2 : (int)x;
-        DRAM.writeBackOutputPixel(y_out, x_out, &OCache);
-
-        LOG_LEVEL_DECR;
-      }
-      LOG_LEVEL_DECR;
+    DRAM_TRACE_LAYER(layer_id);
+    // Run specialized Kernel for this Layer ('same' padding: PAD for 3x3)
+    if (layer.kernel == 3 && layer.stride == 1) {
+      processLayer<3, 1, 1>(layer, &DRAM, &ICache, &WCache, &OCache,
+                            &GPoolCache, &PCache, &BCache, &PE);
+    } else if (layer.kernel == 3) {
+      processLayer<3, 2, 1>(layer, &DRAM, &ICache, &WCache, &OCache,
+                            &GPoolCache, &PCache, &BCache, &PE);
+    } else if (layer.stride == 1) {
+      processLayer<1, 1, 0>(layer, &DRAM, &ICache, &WCache, &OCache,
+                            &GPoolCache, &PCache, &BCache, &PE);
+    } else {
+      processLayer<1, 2, 0>(layer, &DRAM, &ICache, &WCache, &OCache,
+                            &GPoolCache, &PCache, &BCache, &PE);
     }
+
+    // Write Back Performance Counters of this Layer (if enabled)
+    Stats.endLayer();
+    DRAM.writeBackPerfCounters(layer_id);
+    LAYER_PROFILE_END((int)layer_id, layer, Stats);
     LOG_LEVEL_DECR;
   }
   LOG_LEVEL_DECR;
 
-  // Write Back final Result
-  DRAM.writeBackResult(&GPoolCache);
+  // Write Back final Result (all classes, or Top-K only)
+  // (only after Global Pooling: intermediate stages leave feature maps in DRAM)
+  if (layerConfig[last_layer].pool != POOL_GLOBAL) {
+    LOG("Layer Range %d-%d done, no final result\n", (int)first_layer,
+        (int)last_layer);
+  } else if (num_topk == 0) {
+    DRAM.writeBackResult(&GPoolCache);
+  } else {
+    topk_t k = (num_topk > MAX_TOPK) ? MAX_TOPK : num_topk;
+    DRAM.writeBackTopK(&GPoolCache, k);
+  }
 
+  DRAM_TRACE_FLUSH();
   LOG_LEVEL_DECR;
-  printf("FPGA Top finished.\n");
+#ifndef __SYNTHESIS__
+  if (!FPGA_TOP_QUIET) printf("FPGA Top finished.\n");
+#endif
 }
 
 // ===========
 // = LOGGING =
 // ===========
 bool LOG_DETAILS = false;
-int LOG_LEVEL = 0;
+LOG_LEVEL_STORAGE int LOG_LEVEL = 0;
+#ifndef __SYNTHESIS__
+bool FPGA_TOP_QUIET = false;
+#endif
 void print_indent(int lvl) {
-  while (lvl--) {
+  while (lvl-- > 0) {
     putchar(' ');
     putchar(' ');
   }
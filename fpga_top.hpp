@@ -16,6 +16,7 @@
 #include <cassert>
 #include <cmath>
 #include "ap_int.h"
+#include "native_int.hpp"  // INDEX_UINT(W), INDEX_INT(W)
 
 #ifdef __SYNTHESIS__
 #include <ap_utils.h>
@@ -31,19 +32,48 @@
 // ==========================
 // Number of Image Cache Lines (need 3, might chose 4 just because it's nicer)
 const int NUM_IMG_CACHE_LINES = 4;
+#if NET_DESC_CHECKS
+static_assert(NUM_IMG_CACHE_LINES >= 3 && NUM_IMG_CACHE_LINES <= 4,
+              "NUM_IMG_CACHE_LINES: 3x3 window, cacheline_t (2 bit)");
+// MAX_IMAGE_CACHE_SIZE (network.hpp) holds NUM_IMG_CACHE_LINES lines
+NET_CHECK(MAX_IMAGE_CACHE_SIZE,
+          netMaxImageCacheSize(NET_LAYERS, NUM_IMG_CACHE_LINES));
+#endif
 // Number of Processing Elements
 const int N_PE = 1;
+// ARRAY_RESHAPE (cyclic) factor of WeightsCache::BRAM: weights per BRAM word
+// (keep in sync with the pragma in weights_cache.cpp, see autotune.hpp)
+const int WCACHE_RESHAPE_FACTOR = 2;
+// Divide Global Pooling Result by #Output Pixels on FPGA (else done on CPU)
+const bool GPOOL_AVERAGE_ON_FPGA = true;
+// Max. Number of (class, score) pairs selected by on-FPGA Top-K stage
+const int MAX_TOPK = 16;
+// PoolingCache::BRAM Size: MAX_POOL_CACHE_SIZE of network.hpp. Unit tests
+// need room for their max pooling layer (2 lines of 4 x 3 channels), also
+// with networks without max pooling (MAX_POOL_CACHE_SIZE = 1).
+#if DO_UNITTESTS
+const int POOL_CACHE_BRAM_SIZE =
+    (MAX_POOL_CACHE_SIZE > 24) ? MAX_POOL_CACHE_SIZE : 24;
+#else
+const int POOL_CACHE_BRAM_SIZE = MAX_POOL_CACHE_SIZE;
+#endif
+// Number of Job Slots (separate data sections in shared DRAM) for the
+// asynchronous job queue: copy-in, execution + postprocessing overlap
+// (each additional accelerator instance adds one more slot, see runtime.hpp)
+const int NUM_JOB_SLOTS = 3;
 
 // ====================
 // = Type Definitions =
 // ====================
-typedef ap_uint<2> cacheline_t;  // cache height = 4 lines
-typedef ap_uint<NBITS(MAX_INPUT_PER_LAYER)> imgdramoffset_t;
-typedef ap_uint<NBITS(MAX_IMAGE_CACHE_SIZE)> imgcacheaddr_t;
-typedef ap_uint<NBITS(MAX_IMAGE_CACHE_SIZE / 4)> pixelperrow_t;
-typedef ap_uint<4> numfilterelems_t;  // either =1 or =9
+typedef INDEX_UINT(2) cacheline_t;  // cache height = 4 lines
+typedef INDEX_UINT(NBITS(MAX_INPUT_PER_LAYER)) imgdramoffset_t;
+typedef INDEX_UINT(NBITS(MAX_IMAGE_CACHE_SIZE)) imgcacheaddr_t;
+typedef INDEX_UINT(NBITS(MAX_IMAGE_CACHE_SIZE / 4)) pixelperrow_t;
+typedef INDEX_UINT(4) numfilterelems_t;  // either =1 or =9
+typedef INDEX_UINT(NBITS(MAX_TOPK)) topk_t;
+typedef INDEX_UINT(NBITS(POOL_CACHE_BRAM_SIZE)) poolcacheaddr_t;
 
-typedef ap_int<NBITS(MAX_DIMENSION) + 2> coordinate_t;
+typedef INDEX_INT(NBITS(MAX_DIMENSION) + 2) coordinate_t;
 // coordinates run worst-case from -1 ... +W or +H
 // -> need bits for (W or H) + 1 bit more for signed + 1 bit more for +H / +W
 // -> could be implemented more efficiently, but coordinates become more ugly.
@@ -51,18 +81,46 @@ typedef ap_int<NBITS(MAX_DIMENSION) + 2> coordinate_t;
 // ==============================
 // = FPGA Top Function / Module =
 // ==============================
+// num_topk = 0: write back all ch_out global pooling results
+// num_topk > 0: write back only the best num_topk (class, score) pairs
+// first_layer, last_layer: execute only this range of layers (pipelining
+//    across accelerator instances), feature maps remain in shared DRAM.
+//    The final result is only written if last_layer has global pooling.
+// stats_offset > 0: write performance counters of each executed layer to
+//    SHARED_DRAM[stats_offset + layer * NUM_PERF_COUNTERS + ...]
+//    (see perf_counters.hpp, decoded by print_FPGA_perf_counters())
+// cycle_timestamp: free-running cycle counter, driven by RTL (ap_none port)
+//    and sampled for the cycle counters. NULL in C-Sim: cycles are modeled
+//    as loop iterations.
 void fpga_top(data_t *SHARED_DRAM, unsigned int num_layers,
-              unsigned int weights_offset, unsigned int input_offset);
+              unsigned int weights_offset, unsigned int input_offset,
+              unsigned int num_topk = 0, unsigned int first_layer = 0,
+              unsigned int last_layer = MAX_NUM_LAYERS - 1,
+              unsigned int stats_offset = 0,
+              volatile unsigned int *cycle_timestamp = NULL);
+#ifndef __SYNTHESIS__
+// Host only: suppress the "FPGA TOP started / finished" messages (e.g. for
+// benchmarks, which call fpga_top() thousands of times)
+extern bool FPGA_TOP_QUIET;
+#endif
 
 // ================================
 // = Debugging Output (Helper Fn) =
 // ================================
-// debug mode, -DEBUG
-extern int LOG_LEVEL;
+// debug mode, -DEBUG (binary log trace, see log_trace.hpp)
+//             -DEBUG -DLOG_PRINTF (printf)
+// LOG_LEVEL (indentation) is per thread in debug mode: device threads of
+// the runtime log concurrently
+#if defined(EBUG) && !defined(__SYNTHESIS__)
+#define LOG_LEVEL_STORAGE thread_local
+#else
+#define LOG_LEVEL_STORAGE
+#endif
+extern LOG_LEVEL_STORAGE int LOG_LEVEL;
 extern bool LOG_DETAILS;
 void print_indent(int lvl);
 
-#if defined(EBUG) && !defined(__SYNTHESIS__)
+#if defined(EBUG) && !defined(__SYNTHESIS__) && defined(LOG_PRINTF)
 #define FNAME() \
   fprintf(stdout, "\n%s (%s, line %d)\n", __func__, __FILE__, __LINE__)
 #define DBG(...)                 \
@@ -77,6 +135,18 @@ void print_indent(int lvl);
   }
 #define LOG_LEVEL_INCR LOG_LEVEL++
 #define LOG_LEVEL_DECR LOG_LEVEL--
+#elif defined(EBUG) && !defined(__SYNTHESIS__)
+// binary trace ring buffer instead of printf, see log_trace.hpp
+#include "log_trace.hpp"
+#define FNAME()                                                  \
+  logTrace(LOG_NO_INDENT, "\n%s (%s, line %d)\n", __func__, __FILE__, \
+           __LINE__)
+#define DBG(...) \
+  { logTrace(LOG_NO_INDENT, __VA_ARGS__); }
+#define LOG(...) \
+  { logTrace(LOG_LEVEL, __VA_ARGS__); }
+#define LOG_LEVEL_INCR LOG_LEVEL++
+#define LOG_LEVEL_DECR LOG_LEVEL--
 #else
 #define FNAME() \
   do {          \
@@ -42,7 +42,8 @@ void ImageCache::preloadPixelFromDRAM(MemoryController *DRAM) {
 
 L_PRELOAD_PIXEL_CHANNELS:
   for (channel_t ci = 0; ci < ch_in; ci++) {
-#pragma HLS LOOP_TRIPCOUNT min=3 max=1024 avg=237
+#pragma HLS LOOP_TRIPCOUNT min=MIN_CHANNELS_IN max=MAX_CHANNELS_IN \
+    avg=AVG_CHANNELS_IN
 #pragma HLS pipeline II=1 rewind
 
     if (loads_left == 0) {
@@ -67,7 +68,7 @@ void ImageCache::preloadRowFromDRAM(MemoryController *DRAM) {
 
 L_DRAM_PRELOADROW_X:
   for (coordinate_t x = 0; x < width_in; x++) {
-#pragma HLS LOOP_TRIPCOUNT min=8 max=256 avg=45
+#pragma HLS LOOP_TRIPCOUNT min=MIN_DIMENSION max=MAX_DIMENSION avg=AVG_DIMENSION
     preloadPixelFromDRAM(DRAM);
   }
 
@@ -0,0 +1,223 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  layer_profile.cpp
+//
+//  Per-Layer Wall-Clock Profiler (C-Simulation + CPU Engine): ms, GOPS, Bytes
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "layer_profile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "perf_model.hpp"
+
+// =================
+// = Layer Profile =
+// =================
+bool layer_profile_enabled = false;
+
+typedef std::chrono::steady_clock profile_clock;
+
+// Aggregated Executions of one Layer on one Engine
+struct layer_profile_t {
+  std::string name;
+  int runs;
+  double total_ms;
+  double min_ms;
+  double macs;           // per run
+  double bytes_read;     // total of all runs
+  double bytes_written;  // total of all runs
+};
+
+static std::vector<layer_profile_t> profiles[NUM_PROFILE_ENGINES];
+static std::mutex profile_mutex;
+static std::string profile_file;
+static thread_local profile_clock::time_point profile_start;
+
+static const char *engineName(int engine) {
+  return (engine == PROFILE_FPGA_CSIM) ? "fpga_csim" : "cpu_engine";
+}
+
+// Layer Name (layers configured from DRAM on the FPGA have no names:
+// same layer of another engine, else "-")
+static std::string layerName(int engine, size_t layer_id) {
+  for (int e = engine; e < engine + NUM_PROFILE_ENGINES; e++) {
+    const std::vector<layer_profile_t> &p = profiles[e % NUM_PROFILE_ENGINES];
+    if (layer_id < p.size() && !p[layer_id].name.empty())
+      return p[layer_id].name;
+  }
+  return "-";
+}
+
+static void writeLayerProfileAtExit() {
+  printf("\n");
+  printLayerProfile(stdout);
+  if (profile_file.empty()) return;
+  FILE *out = fopen(profile_file.c_str(), "w");
+  if (!out) {
+    printf("ERROR: File %s could not be opened!\n", profile_file.c_str());
+    return;
+  }
+  size_t len = profile_file.size();
+  if (len >= 4 && profile_file.compare(len - 4, 4, ".csv") == 0)
+    printLayerProfileCSV(out);
+  else
+    printLayerProfileJSON(out);
+  fclose(out);
+  printf("CPU: Layer Profile written to %s\n", profile_file.c_str());
+}
+
+bool layerProfileOpen(const char *filename) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  if (filename) {
+    // (written at exit: check now that the file can be created)
+    FILE *out = fopen(filename, "w");
+    if (!out) {
+      printf("ERROR: File %s could not be opened!\n", filename);
+      return false;
+    }
+    fclose(out);
+    profile_file = filename;
+  }
+  if (!layer_profile_enabled) atexit(writeLayerProfileAtExit);
+  layer_profile_enabled = true;
+  return true;
+}
+
+void layerProfileStart() { profile_start = profile_clock::now(); }
+
+void layerProfileEnd(profileengine_t engine, int layer_id, layer_t &layer,
+                     double bytes_read, double bytes_written) {
+  double ms = std::chrono::duration<double, std::milli>(profile_clock::now() -
+                                                        profile_start)
+                  .count();
+  layer_perf_t perf = estimateLayerPerformance(&layer, defaultPerfArch());
+  if (bytes_read < 0) bytes_read = perf.dram_read_bytes;
+  if (bytes_written < 0) bytes_written = perf.dram_write_bytes;
+
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  std::vector<layer_profile_t> &p = profiles[engine];
+  if ((int)p.size() <= layer_id) {
+    layer_profile_t empty = {"", 0, 0, 0, 0, 0, 0};
+    p.resize(layer_id + 1, empty);
+  }
+  layer_profile_t &lp = p[layer_id];
+  if (lp.runs == 0) {
+    lp.name = layer.name;
+    lp.name.erase(lp.name.find_last_not_of(' ') + 1);
+    lp.min_ms = ms;
+    lp.macs = perf.macs;
+  }
+  lp.runs++;
+  lp.total_ms += ms;
+  lp.min_ms = std::min(lp.min_ms, ms);
+  lp.bytes_read += bytes_read;
+  lp.bytes_written += bytes_written;
+}
+
+// ==========
+// = Report =
+// ==========
+// (GOPS: 2 operations per MAC, per mean run; Bytes: per run)
+
+void printLayerProfile(FILE *out) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  for (int e = 0; e < NUM_PROFILE_ENGINES; e++) {
+    const std::vector<layer_profile_t> &p = profiles[e];
+    double total_ms = 0, total_macs = 0, total_bytes = 0;
+    for (size_t i = 0; i < p.size(); i++)
+      if (p[i].runs) total_ms += p[i].total_ms / p[i].runs;
+    if (total_ms == 0) continue;
+
+    fprintf(out, "Layer Profile (%s, wall-clock per run):\n", engineName(e));
+    fprintf(out, "%3s %-8s: %5s %10s %10s %6s %9s %7s %9s %9s\n", "id",
+            "layer", "runs", "ms", "min ms", "%", "MMACs", "GOPS", "rd [kB]",
+            "wr [kB]");
+    for (size_t i = 0; i < p.size(); i++) {
+      const layer_profile_t &lp = p[i];
+      if (lp.runs == 0) continue;
+      double ms = lp.total_ms / lp.runs;
+      fprintf(out, "%3d %-8s: %5d %10.3f %10.3f %5.1f%% %9.2f %7.3f %9.1f "
+                   "%9.1f\n",
+              (int)i, layerName(e, i).c_str(), lp.runs, ms, lp.min_ms,
+              100 * ms / total_ms, lp.macs / 1e6, 2 * lp.macs / (ms * 1e6),
+              lp.bytes_read / lp.runs / 1024,
+              lp.bytes_written / lp.runs / 1024);
+      total_macs += lp.macs;
+      total_bytes += (lp.bytes_read + lp.bytes_written) / lp.runs;
+    }
+    fprintf(out, "%12s: %5s %10.3f %10s %6s %9.2f %7.3f %19.1f\n", "total",
+            "", total_ms, "", "", total_macs / 1e6,
+            2 * total_macs / (total_ms * 1e6), total_bytes / 1024);
+  }
+}
+
+void printLayerProfileCSV(FILE *out) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  fprintf(out, "engine,layer_id,layer,runs,mean_ms,min_ms,total_ms,macs,"
+               "gops,bytes_read,bytes_written\n");
+  for (int e = 0; e < NUM_PROFILE_ENGINES; e++) {
+    const std::vector<layer_profile_t> &p = profiles[e];
+    for (size_t i = 0; i < p.size(); i++) {
+      const layer_profile_t &lp = p[i];
+      if (lp.runs == 0) continue;
+      double ms = lp.total_ms / lp.runs;
+      fprintf(out, "%s,%d,%s,%d,%.6f,%.6f,%.6f,%.0f,%.6f,%.0f,%.0f\n",
+              engineName(e), (int)i, layerName(e, i).c_str(), lp.runs, ms,
+              lp.min_ms, lp.total_ms, lp.macs, 2 * lp.macs / (ms * 1e6),
+              lp.bytes_read / lp.runs, lp.bytes_written / lp.runs);
+    }
+  }
+}
+
+void printLayerProfileJSON(FILE *out) {
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  fprintf(out, "{\n  \"layers\": [");
+  const char *sep = "\n";
+  for (int e = 0; e < NUM_PROFILE_ENGINES; e++) {
+    const std::vector<layer_profile_t> &p = profiles[e];
+    for (size_t i = 0; i < p.size(); i++) {
+      const layer_profile_t &lp = p[i];
+      if (lp.runs == 0) continue;
+      double ms = lp.total_ms / lp.runs;
+      fprintf(out,
+              "%s    {\"engine\": \"%s\", \"layer_id\": %d, \"name\": \"%s\", "
+              "\"runs\": %d, \"mean_ms\": %.6f, \"min_ms\": %.6f, "
+              "\"total_ms\": %.6f, \"macs\": %.0f, \"gops\": %.6f, "
+              "\"bytes_read\": %.0f, \"bytes_written\": %.0f}",
+              sep, engineName(e), (int)i, layerName(e, i).c_str(), lp.runs, ms,
+              lp.min_ms, lp.total_ms, lp.macs, 2 * lp.macs / (ms * 1e6),
+              lp.bytes_read / lp.runs, lp.bytes_written / lp.runs);
+      sep = ",\n";
+    }
+  }
+  fprintf(out, "\n  ],\n  \"total\": [");
+  sep = "\n";
+  for (int e = 0; e < NUM_PROFILE_ENGINES; e++) {
+    const std::vector<layer_profile_t> &p = profiles[e];
+    double total_ms = 0, total_macs = 0, total_bytes = 0;
+    for (size_t i = 0; i < p.size(); i++) {
+      if (p[i].runs == 0) continue;
+      total_ms += p[i].total_ms / p[i].runs;
+      total_macs += p[i].macs;
+      total_bytes += (p[i].bytes_read + p[i].bytes_written) / p[i].runs;
+    }
+    if (total_ms == 0) continue;
+    fprintf(out,
+            "%s    {\"engine\": \"%s\", \"ms\": %.6f, \"macs\": %.0f, "
+            "\"gops\": %.6f, \"bytes\": %.0f}",
+            sep, engineName(e), total_ms, total_macs,
+            2 * total_macs / (total_ms * 1e6), total_bytes);
+    sep = ",\n";
+  }
+  fprintf(out, "\n  ]\n}\n");
+}
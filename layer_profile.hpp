@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  layer_profile.hpp
+//
+//  Per-Layer Wall-Clock Profiler (C-Simulation + CPU Engine): ms, GOPS, Bytes
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef LAYER_PROFILE_HPP_3F8A0D52
+#define LAYER_PROFILE_HPP_3F8A0D52
+
+#include <cstdio>
+#include "network.hpp"  // load before netconfig.hpp for bit-width calculation
+#include "netconfig.hpp"
+
+// =================
+// = Layer Profile =
+// =================
+// Each iteration of L_LAYERS in fpga_top() (and each layer of the CPU
+// engine) is timed on the host after layerProfileOpen(). Executions are
+// aggregated per engine and layer: runs, ms (total, min), MACs, GOPS and
+// Bytes moved (C-Sim: performance counters of the layer, without the final
+// result; CPU engine: DRAM traffic of the performance model).
+// In synthesis the macros are empty.
+typedef enum {
+  PROFILE_FPGA_CSIM,   // fpga_top() (C-Simulation of the accelerator)
+  PROFILE_CPU_ENGINE,  // CPUEngine::run()
+  NUM_PROFILE_ENGINES
+} profileengine_t;
+
+#ifndef __SYNTHESIS__
+extern bool layer_profile_enabled;
+// Start profiling; at program exit the table is printed to stdout and
+// written to FILENAME (".csv": CSV, else JSON; NULL: table only)
+bool layerProfileOpen(const char *filename);
+void layerProfileStart();
+// Record time since layerProfileStart() of this thread
+// (bytes < 0: use DRAM traffic estimated by the performance model)
+void layerProfileEnd(profileengine_t engine, int layer_id, layer_t &layer,
+                     double bytes_read, double bytes_written);
+
+#define LAYER_PROFILE_START()                       \
+  {                                                 \
+    if (layer_profile_enabled) layerProfileStart(); \
+  }
+#define LAYER_PROFILE_END(layer_id, layer, stats)                          \
+  {                                                                        \
+    if (layer_profile_enabled)                                             \
+      layerProfileEnd(PROFILE_FPGA_CSIM, layer_id, layer,                  \
+                      (double)stats.get(PERF_WORDS_READ) * sizeof(data_t), \
+                      (double)stats.get(PERF_WORDS_WRITTEN) *              \
+                          sizeof(data_t));                                 \
+  }
+#else
+#define LAYER_PROFILE_START() \
+  {}
+#define LAYER_PROFILE_END(layer_id, layer, stats) \
+  {}
+#endif
+
+// ==========
+// = Report =
+// ==========
+// Table: one line per engine + layer, total per engine
+void printLayerProfile(FILE *out);
+// CSV: header + one line per engine + layer
+void printLayerProfileCSV(FILE *out);
+// JSON: {"layers": [..], "total": [..]}
+void printLayerProfileJSON(FILE *out);
+
+#endif /* end of include guard: LAYER_PROFILE_HPP_3F8A0D52 */
@@ -0,0 +1,323 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  log_trace.cpp
+//
+//  Binary Event Trace for Debug Builds (replaces printf in LOG / DBG)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "log_trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// ==================
+// = Per-Thread Ring =
+// ==================
+struct log_ring_t {
+  int thread;
+  unsigned long long count;  // records written (ring keeps the last ones)
+  log_record_t *records;     // LOG_TRACE_SIZE records
+};
+
+// Rings stay allocated after their thread ended (until the dump). Fixed
+// table, read without locking by the crash handler (rings of threads
+// beyond LOG_TRACE_MAX_THREADS are not dumped)
+const int LOG_TRACE_MAX_THREADS = 1024;
+static log_ring_t *log_rings[LOG_TRACE_MAX_THREADS];
+static std::atomic<int> num_log_rings(0);
+static std::mutex log_rings_mutex;
+static thread_local log_ring_t *log_ring = NULL;
+
+static void logTraceOnFailure(int sig);
+
+log_record_t &logTraceNext() {
+  if (!log_ring) {
+    std::lock_guard<std::mutex> lock(log_rings_mutex);
+    int n = num_log_rings.load();
+    if (n == 0) {
+      signal(SIGABRT, logTraceOnFailure);
+      signal(SIGSEGV, logTraceOnFailure);
+    }
+    log_ring = new log_ring_t;
+    log_ring->thread = n;
+    log_ring->count = 0;
+    log_ring->records = new log_record_t[LOG_TRACE_SIZE]();
+    if (n < LOG_TRACE_MAX_THREADS) {
+      log_rings[n] = log_ring;
+      num_log_rings.store(n + 1);
+    }
+  }
+  return log_ring->records[log_ring->count++ % LOG_TRACE_SIZE];
+}
+
+// ===================
+// = Dump Trace File =
+// ===================
+// Format (host byte order):
+//   "LOGTRACE", uint32 num_strings, strings (uint32 length, chars),
+//   uint32 num_threads, per thread: uint32 thread, uint64 count,
+//   uint32 num_records, records (uint32 format string, int16 level,
+//   uint8 num_args, num_args x (uint8 type, 8 Bytes value or string id))
+// Written only with write(2) and static buffers (no stdio, heap or locks),
+// so that the crash handler can use it (async-signal-safe)
+const int LOG_TRACE_MAX_STRINGS = 1 << 16;  // hash slots, half usable
+static const char *dump_string_keys[LOG_TRACE_MAX_STRINGS];
+static uint32_t dump_string_ids[LOG_TRACE_MAX_STRINGS];
+static const char *dump_strings[LOG_TRACE_MAX_STRINGS / 2];  // by id
+static uint32_t dump_num_strings;
+static char dump_buffer[1 << 16];
+static size_t dump_buffer_used;
+static int dump_fd;
+static std::atomic<bool> dump_active(false);
+
+static void dumpFlush() {
+  for (size_t done = 0; done < dump_buffer_used;) {
+    ssize_t n = write(dump_fd, dump_buffer + done, dump_buffer_used - done);
+    if (n <= 0) break;
+    done += n;
+  }
+  dump_buffer_used = 0;
+}
+
+static void dumpWrite(const void *data, size_t size) {
+  const char *bytes = (const char *)data;
+  while (size > 0) {
+    if (dump_buffer_used == sizeof(dump_buffer)) dumpFlush();
+    size_t n = std::min(size, sizeof(dump_buffer) - dump_buffer_used);
+    memcpy(dump_buffer + dump_buffer_used, bytes, n);
+    dump_buffer_used += n;
+    bytes += n;
+    size -= n;
+  }
+}
+
+static void writeU32(uint32_t v) { dumpWrite(&v, sizeof(v)); }
+
+// String Table: format strings + %s arguments (by pointer), open addressing
+// (ids of strings that do not fit are out of range, decoded as "<?>")
+static uint32_t stringId(const char *s) {
+  if (!s) s = "(null)";
+  uint32_t slot = (uint32_t)(((uintptr_t)s >> 3) * 2654435761u);
+  for (int probe = 0; probe < LOG_TRACE_MAX_STRINGS; probe++, slot++) {
+    slot %= LOG_TRACE_MAX_STRINGS;
+    if (dump_string_keys[slot] == s) return dump_string_ids[slot];
+    if (dump_string_keys[slot]) continue;
+    if (dump_num_strings == LOG_TRACE_MAX_STRINGS / 2) break;
+    dump_string_keys[slot] = s;
+    dump_string_ids[slot] = dump_num_strings;
+    dump_strings[dump_num_strings] = s;
+    return dump_num_strings++;
+  }
+  return LOG_TRACE_MAX_STRINGS;
+}
+
+static void writeLogTrace(int fd) {
+  dump_fd = fd;
+  dump_buffer_used = 0;
+  dump_num_strings = 0;
+  memset(dump_string_keys, 0, sizeof(dump_string_keys));
+  int num_rings = std::min(num_log_rings.load(), LOG_TRACE_MAX_THREADS);
+
+  // String Table
+  for (int t = 0; t < num_rings; t++) {
+    log_ring_t *ring = log_rings[t];
+    unsigned long long n = std::min(ring->count, (unsigned long long)
+                                                     LOG_TRACE_SIZE);
+    for (unsigned long long i = ring->count - n; i < ring->count; i++) {
+      log_record_t &r = ring->records[i % LOG_TRACE_SIZE];
+      stringId(r.format);
+      for (int a = 0; a < r.num_args; a++)
+        if (r.types[a] == LOG_ARG_STRING) stringId(r.args[a].s);
+    }
+  }
+  dumpWrite("LOGTRACE", 8);
+  writeU32(dump_num_strings);
+  for (uint32_t i = 0; i < dump_num_strings; i++) {
+    writeU32(strlen(dump_strings[i]));
+    dumpWrite(dump_strings[i], strlen(dump_strings[i]));
+  }
+
+  // Records of all Threads (oldest first)
+  writeU32(num_rings);
+  for (int t = 0; t < num_rings; t++) {
+    log_ring_t *ring = log_rings[t];
+    unsigned long long n = std::min(ring->count, (unsigned long long)
+                                                     LOG_TRACE_SIZE);
+    writeU32(ring->thread);
+    dumpWrite(&ring->count, sizeof(ring->count));
+    writeU32(n);
+    for (unsigned long long i = ring->count - n; i < ring->count; i++) {
+      log_record_t &r = ring->records[i % LOG_TRACE_SIZE];
+      writeU32(stringId(r.format));
+      dumpWrite(&r.level, sizeof(r.level));
+      dumpWrite(&r.num_args, sizeof(r.num_args));
+      for (int a = 0; a < r.num_args; a++) {
+        long long value = r.args[a].i;
+        if (r.types[a] == LOG_ARG_STRING) value = stringId(r.args[a].s);
+        dumpWrite(&r.types[a], sizeof(r.types[a]));
+        dumpWrite(&value, sizeof(value));
+      }
+    }
+  }
+  dumpFlush();
+}
+
+bool logTraceDump(const char *filename) {
+  std::lock_guard<std::mutex> lock(log_rings_mutex);
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: Log trace file %s could not be opened!\n",
+            filename);
+    return false;
+  }
+  dump_active = true;
+  writeLogTrace(fd);
+  dump_active = false;
+  close(fd);
+  return true;
+}
+
+// Signal Handler (abort(), segmentation fault): async-signal-safe, does not
+// lock log_rings_mutex (the failing thread may hold it), skips the dump if
+// the signal interrupted one (its static buffers are in use)
+static void logTraceOnFailure(int sig) {
+  const char *name = (sig == SIGSEGV) ? "\nSIGSEGV" : "\nSIGABRT";
+  const char msg[] = ": dumping log trace to " LOG_TRACE_FILE "\n";
+  ssize_t written = write(STDERR_FILENO, name, strlen(name));
+  written = write(STDERR_FILENO, msg, sizeof(msg) - 1);
+  (void)written;
+  if (!dump_active.exchange(true)) {
+    int fd = open(LOG_TRACE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      writeLogTrace(fd);
+      close(fd);
+    }
+  }
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+// ==================
+// = Decode + Print =
+// ==================
+// Format one record like printf (one conversion at a time)
+static std::string formatRecord(const std::string &format,
+                                const uint8_t *types, const long long *values,
+                                int num_args,
+                                const std::vector<std::string> &strings) {
+  std::string text;
+  char buffer[512];
+  int a = 0;
+  for (size_t i = 0; i < format.size(); i++) {
+    if (format[i] != '%') {
+      text += format[i];
+      continue;
+    }
+    if (i + 1 < format.size() && format[i + 1] == '%') {
+      text += '%';
+      i++;
+      continue;
+    }
+    // Conversion Specification: flags, width, precision, length, type
+    size_t end = i + 1;
+    while (end < format.size() && strchr("-+ #0123456789.", format[end]))
+      end++;
+    std::string spec = format.substr(i, end - i);
+    while (end < format.size() && strchr("hlLqjzt", format[end])) end++;
+    if (end >= format.size()) break;
+    char conversion = format[end];
+    i = end;
+    if (a >= num_args) {
+      text += "<?>";
+      continue;
+    }
+    union { long long i; double d; } v;
+    v.i = values[a];
+    if (strchr("fFeEgGaA", conversion)) {
+      double d = (types[a] == LOG_ARG_DOUBLE) ? v.d : (double)v.i;
+      snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), d);
+    } else if (conversion == 's') {
+      const char *s = (types[a] == LOG_ARG_STRING && v.i < (long long)
+                                                         strings.size())
+                          ? strings[v.i].c_str()
+                          : "<?>";
+      snprintf(buffer, sizeof(buffer), (spec + 's').c_str(), s);
+    } else if (conversion == 'c') {
+      snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), (int)v.i);
+    } else if (conversion == 'p') {
+      snprintf(buffer, sizeof(buffer), "%p", (void *)v.i);
+    } else {
+      long long n = (types[a] == LOG_ARG_DOUBLE) ? (long long)v.d : v.i;
+      snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), n);
+    }
+    text += buffer;
+    a++;
+  }
+  return text;
+}
+
+int decodeLogTrace(const char *filename, FILE *out) {
+  FILE *f = fopen(filename, "rb");
+  char magic[8];
+  if (!f || fread(magic, 8, 1, f) != 1 || memcmp(magic, "LOGTRACE", 8)) {
+    printf("ERROR: %s is not a log trace file!\n", filename);
+    if (f) fclose(f);
+    return -1;
+  }
+  auto readU32 = [&]() {
+    uint32_t v = 0;
+    if (fread(&v, sizeof(v), 1, f) != 1) v = 0;
+    return v;
+  };
+
+  std::vector<std::string> strings(readU32());
+  for (size_t i = 0; i < strings.size(); i++) {
+    strings[i].resize(readU32());
+    if (!strings[i].empty() &&
+        fread(&strings[i][0], strings[i].size(), 1, f) != 1)
+      break;
+  }
+
+  int num_threads = readU32(), num_decoded = 0;
+  for (int t = 0; t < num_threads; t++) {
+    uint32_t thread = readU32();
+    unsigned long long count = 0;
+    if (fread(&count, sizeof(count), 1, f) != 1) break;
+    uint32_t num_records = readU32();
+    fprintf(out, "==== Thread %u: last %u of %llu log records ====\n", thread,
+            num_records, count);
+    for (uint32_t i = 0; i < num_records; i++) {
+      uint32_t format = readU32();
+      int16_t level = 0;
+      uint8_t num_args = 0, types[LOG_TRACE_MAX_ARGS];
+      long long values[LOG_TRACE_MAX_ARGS];
+      if (fread(&level, sizeof(level), 1, f) != 1 ||
+          fread(&num_args, sizeof(num_args), 1, f) != 1)
+        break;
+      for (int a = 0; a < num_args && a < LOG_TRACE_MAX_ARGS; a++) {
+        if (fread(&types[a], sizeof(types[a]), 1, f) != 1 ||
+            fread(&values[a], sizeof(values[a]), 1, f) != 1)
+          break;
+      }
+      for (int l = 0; l < level; l++) fputs("  ", out);
+      fputs(formatRecord(format < strings.size() ? strings[format] : "<?>\n",
+                         types, values, num_args, strings)
+                .c_str(),
+            out);
+      num_decoded++;
+    }
+  }
+  fclose(f);
+  return num_decoded;
+}
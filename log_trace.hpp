@@ -0,0 +1,98 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  log_trace.hpp
+//
+//  Binary Event Trace for Debug Builds (replaces printf in LOG / DBG)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef LOG_TRACE_HPP_C7E25B18
+#define LOG_TRACE_HPP_C7E25B18
+
+#include <cstdio>
+#include <stdint.h>
+#include <type_traits>
+
+// =====================
+// = Binary Log Tracer =
+// =====================
+// With -DEBUG, LOG(...) / DBG(...) do not call printf: they append a
+// fixed-size record (format string pointer, indentation, up to
+// LOG_TRACE_MAX_ARGS arguments) to a ring buffer of the calling thread,
+// which keeps the last LOG_TRACE_SIZE records. Formatting only happens when
+// the trace is decoded.
+// The rings of all threads are written to LOG_TRACE_FILE:
+// - on demand: logTraceDump()
+// - on failure: abort() (failed assert), segmentation fault
+// Decode with "./test --decode-log <file>" (prints the same text as the
+// printf-based LOG, ordered by thread). Format strings must be literals,
+// %s arguments must remain valid until the dump (literals, names).
+// Compile with -DEBUG -DLOG_PRINTF for the old direct printf output.
+#ifndef LOG_TRACE_SIZE
+#define LOG_TRACE_SIZE (1 << 18)
+#endif
+#ifndef LOG_TRACE_FILE
+#define LOG_TRACE_FILE "log_trace.bin"
+#endif
+const int LOG_TRACE_MAX_ARGS = 8;
+const int LOG_NO_INDENT = -1;  // level of DBG() records
+
+typedef enum { LOG_ARG_INT, LOG_ARG_DOUBLE, LOG_ARG_STRING } logargtype_t;
+struct log_record_t {
+  const char *format;
+  int16_t level;  // indentation (LOG_LEVEL), LOG_NO_INDENT
+  uint8_t num_args;
+  uint8_t types[LOG_TRACE_MAX_ARGS];  // logargtype_t
+  union {
+    long long i;
+    double d;
+    const char *s;
+  } args[LOG_TRACE_MAX_ARGS];
+};
+
+log_record_t &logTraceNext();  // next slot in ring of calling thread
+bool logTraceDump(const char *filename = LOG_TRACE_FILE);
+int decodeLogTrace(const char *filename, FILE *out);
+
+// Store one Argument (as printf would receive it after promotion)
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+logTraceArg(log_record_t &r, const T &v) {
+  r.types[r.num_args] = LOG_ARG_DOUBLE;
+  r.args[r.num_args++].d = v;
+}
+inline void logTraceArg(log_record_t &r, const char *v) {
+  r.types[r.num_args] = LOG_ARG_STRING;
+  r.args[r.num_args++].s = v;
+}
+inline void logTraceArg(log_record_t &r, char *v) {
+  logTraceArg(r, (const char *)v);
+}
+template <typename T>
+inline typename std::enable_if<!std::is_floating_point<T>::value>::type
+logTraceArg(log_record_t &r, const T &v) {
+  r.types[r.num_args] = LOG_ARG_INT;
+  r.args[r.num_args++].i = (long long)v;
+}
+
+inline void logTraceArgs(log_record_t &r) {}
+template <typename T, typename... Rest>
+inline void logTraceArgs(log_record_t &r, const T &v, const Rest &... rest) {
+  if (r.num_args < LOG_TRACE_MAX_ARGS) logTraceArg(r, v);
+  logTraceArgs(r, rest...);
+}
+
+template <typename... Args>
+inline void logTrace(int level, const char *format, const Args &... args) {
+  log_record_t &r = logTraceNext();
+  r.format = format;
+  r.level = level;
+  r.num_args = 0;
+  logTraceArgs(r, args...);
+}
+
+#endif /* end of include guard: LOG_TRACE_HPP_C7E25B18 */
@@ -17,10 +17,13 @@
 // =====================
 MemoryController::MemoryController(data_t *mempointer,
                                    unsigned int weights_offset,
-                                   unsigned int data_offset)
+                                   unsigned int data_offset,
+                                   unsigned int stats_offset)
     : SHARED_DRAM(mempointer) {
   DRAM_WEIGHTS = (SHARED_DRAM + weights_offset);
   DRAM_DATA = (SHARED_DRAM + data_offset);
+  DRAM_STATS = (SHARED_DRAM + stats_offset);
+  stats_enabled = (stats_offset != 0);
 
   LOG("MemoryCtrl: Constructor.\n");
   LOG(" - SHARED_DRAM     = %lu\n", (long)SHARED_DRAM);
@@ -40,7 +43,8 @@ void MemoryController::loadConfigViaFloatUnion(int num_layers,
   layer_t layer;
 L_LoadConfig:
   for (numlayers_t l = 0; l < num_layers; l++) {
-#pragma HLS LOOP_TRIPCOUNT min=26 max=26 avg=26
+#pragma HLS LOOP_TRIPCOUNT min=MAX_NUM_LAYERS max=MAX_NUM_LAYERS \
+    avg=MAX_NUM_LAYERS
     memcpy(floats, &SHARED_DRAM[l * NUM_FLOATS_PER_LAYER],
            NUM_FLOATS_PER_LAYER * sizeof(float));
     floatsToLayerT(floats, layer);
@@ -69,8 +73,12 @@ void MemoryController::floatsToLayerT(float floats[NUM_FLOATS_PER_LAYER],
   u.f = floats[7]; layer.mem_addr_input = u.i;
   u.f = floats[8]; layer.mem_addr_output = u.i;
   u.f = floats[9]; layer.mem_addr_weights = u.i;
-  u.f = floats[10]; layer.is_expand_layer = u.i;
-  u.f = floats[11]; layer.pool = (u.i == 1 ? POOL_GLOBAL : POOL_NONE);
+  u.f = floats[10]; layer.out_pixel_stride = u.i;
+  u.f = floats[11]; layer.pool = (pooltype_t)u.i;
+  u.f = floats[12]; layer.groups = u.i;
+  u.f = floats[13]; layer.has_bypass = u.i;
+  u.f = floats[14]; layer.mem_addr_bypass = u.i;
+  u.f = floats[15]; layer.out_channel_offset = u.i;
   // clang-format on
 }
 
@@ -78,10 +86,18 @@ void MemoryController::setLayerConfig(layer_t &layer) {
   dram_weights_offset = layer.mem_addr_weights;
   dram_input_offset = layer.mem_addr_input;
   dram_output_offset = layer.mem_addr_output;
+  dram_bypass_offset = layer.mem_addr_bypass;
   pixels_per_row = layer.width * layer.channels_in;
   ch_out = layer.channels_out;
   width_out = (layer.stride == 2) ? (layer.width / 2) : (layer.width / 1);
-  is_expand_layer = layer.is_expand_layer;
+  height_out = (layer.stride == 2) ? (layer.height / 2) : (layer.height / 1);
+  if (layer.pool == POOL_2x2S2 || layer.pool == POOL_3x3S2) {
+    // Fused Max Pooling: only pooled output pixels are written back
+    width_out = pooled_dimension(width_out, layer.pool);
+    height_out = pooled_dimension(height_out, layer.pool);
+  }
+  out_pixel_stride = layer.out_pixel_stride;
+  out_channel_offset = layer.out_channel_offset;
 
   LOG("MemoryCtrl: setLayerConfig.\n");
   LOG(" - weights offset  = %6d Elements, DRAM @%8luB\n",
@@ -90,19 +106,29 @@ void MemoryController::setLayerConfig(layer_t &layer) {
       (int)dram_input_offset, (int)dram_input_offset * sizeof(data_t));
   LOG(" - output offset   = %6d Elements, DRAM @%8luB\n",
       (int)dram_output_offset, (int)dram_output_offset * sizeof(data_t));
+  LOG(" - bypass offset   = %6d Elements, DRAM @%8luB\n",
+      (int)dram_bypass_offset, (int)dram_bypass_offset * sizeof(data_t));
   LOG(" - pixels per row  = %d\n", (int)pixels_per_row);
   LOG(" - ch_out          = %d\n", (int)ch_out);
   LOG(" - width_out       = %d\n", (int)width_out);
-  LOG(" - is_expand_layer = %d\n", (int)is_expand_layer);
+  LOG(" - height_out      = %d\n", (int)height_out);
+  LOG(" - out_px_stride   = %d\n", (int)out_pixel_stride);
+  LOG(" - out_ch_offset   = %d\n", (int)out_channel_offset);
 }
 
 data_t MemoryController::loadNextWeight() {
+  counter_t stall_start = Stats.timestamp();
   if (LOG_DETAILS)
     LOG("MemoryCtrl: loadNextWeight  (#%4d from DRAM @%4luB): %6.2f\n",
         (int)dram_weights_offset,
         (long)&DRAM_WEIGHTS[dram_weights_offset] - (long)DRAM_DATA,
         DRAM_WEIGHTS[dram_weights_offset]);
-  return DRAM_WEIGHTS[dram_weights_offset++];
+  Stats.countDRAMRead();
+  DRAM_TRACE(DRAM_WEIGHTS_READ,
+             &DRAM_WEIGHTS[dram_weights_offset] - SHARED_DRAM, 1);
+  data_t weight = DRAM_WEIGHTS[dram_weights_offset++];
+  Stats.countStall(stall_start);
+  return weight;
 }
 
 void MemoryController::setPixelLoadRow(coordinate_t y) {
@@ -111,48 +137,195 @@ void MemoryController::setPixelLoadRow(coordinate_t y) {
 }
 
 data_t MemoryController::loadNextChannel() {
+  counter_t stall_start = Stats.timestamp();
   data_t pixel_from_ram = DRAM_DATA[dram_pixel_offset];
+  DRAM_TRACE(DRAM_PIXEL_READ, &DRAM_DATA[dram_pixel_offset] - SHARED_DRAM, 1);
   if (LOG_DETAILS)
     LOG("MemoryCtrl: loadNextChannel (from DRAM @%4luB) -> %.2f\n",
         (int)dram_pixel_offset * sizeof(data_t), pixel_from_ram);
   dram_pixel_offset++;  // increment address for next fetch
+  Stats.countDRAMRead();
+  Stats.countStall(stall_start);
   return pixel_from_ram;
 };
 
+memaddr_t MemoryController::outputPixelOffset(coordinate_t y_out,
+                                             coordinate_t x_out) {
+  // Calculate Offset of Pixel within Output (or Bypass) Feature Map
+  // (concatenated maps: out_pixel_stride > ch_out, channels start at offset)
+  memaddr_t px_offset = out_pixel_stride * (width_out * y_out + x_out);
+  return px_offset + out_channel_offset;
+}
+
+void MemoryController::setOutputPixel(coordinate_t y_out, coordinate_t x_out) {
+  // Calculate Output Memory Address
+  dram_output_px_offset = dram_output_offset + outputPixelOffset(y_out, x_out);
+
+  LOG("MemoryCtrl: setOutputPixel (%2d, %2d) -> DRAM @%luB+\n", (int)y_out,
+      (int)x_out, (long)dram_output_px_offset * sizeof(data_t));
+}
+
+void MemoryController::storeNextChannel(data_t value) {
+  if (LOG_DETAILS)
+    LOG("MemoryCtrl: storeNextChannel (to DRAM @%4luB) <- %.2f\n",
+        (long)dram_output_px_offset * sizeof(data_t), value);
+  DRAM_DATA[dram_output_px_offset] = value;
+  DRAM_TRACE(DRAM_OUTPUT_WRITE,
+             &DRAM_DATA[dram_output_px_offset] - SHARED_DRAM, 1);
+  dram_output_px_offset++;  // increment address for next store
+  Stats.countDRAMWrite();
+}
+
 void MemoryController::writeBackOutputPixel(coordinate_t y_out,
                                             coordinate_t x_out,
                                             OutputCache *outputCache) {
-  // Calculate Output Memory Address
-  memaddr_t px_offset = ch_out * (width_out * y_out + x_out);
-  data_t *DRAM_LAYER_OUT, *DRAM_PX_OUT;
-  DRAM_LAYER_OUT = (DRAM_DATA + dram_output_offset);
-  // Leave double space for "expand" layers (more ch_out will be added)
-  DRAM_PX_OUT =
-      DRAM_LAYER_OUT + (is_expand_layer ? 2 * (int)px_offset : (int)px_offset);
-
   LOG("MemoryController: writeBackOutputPixel (%2d, %2d)\n", (int)y_out,
       (int)x_out);
+  setOutputPixel(y_out, x_out);
   LOG(" - writing %2d channels to DRAM @%luB+\n", (int)ch_out,
-      (long)DRAM_PX_OUT - (long)DRAM_DATA);
+      (long)dram_output_px_offset * sizeof(data_t));
 
   LOG_LEVEL_DECR;
 L_writeBackOutputPixel:
   for (channel_t co = 0; co < ch_out; co++) {
-#pragma HLS LOOP_TRIPCOUNT min=16 max=1024 avg=258
-	DRAM_PX_OUT[co] = outputCache->getChannel(co);
+#pragma HLS LOOP_TRIPCOUNT min=MIN_NUM_CHOUT max=MAX_NUM_CHOUT avg=AVG_NUM_CHOUT
     LOG(" WB ch%d (@%luB): %6.2f\n", (int)co,
-        ((long)(DRAM_PX_OUT + co) - (long)DRAM_DATA), outputCache->getChannel(co));
+        (long)dram_output_px_offset * sizeof(data_t),
+        outputCache->getChannel(co));
+    storeNextChannel(outputCache->getChannel(co));
   }
   LOG_LEVEL_DECR;
 }
 
+void MemoryController::loadBypassPixel(coordinate_t y_out, coordinate_t x_out,
+                                       OutputCache *bypassCache) {
+  // Bypass Feature Map has same shape + layout as Output Feature Map
+  memaddr_t dram_bypass_px_offset =
+      dram_bypass_offset + outputPixelOffset(y_out, x_out);
+
+  LOG("MemoryController: loadBypassPixel (%2d, %2d)\n", (int)y_out, (int)x_out);
+  LOG(" - reading %2d channels from DRAM @%luB+\n", (int)ch_out,
+      (long)dram_bypass_px_offset * sizeof(data_t));
+
+L_loadBypassPixel:
+  for (channel_t co = 0; co < ch_out; co++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_NUM_CHOUT max=MAX_NUM_CHOUT avg=AVG_NUM_CHOUT
+#pragma HLS pipeline
+    bypassCache->setChannel(co, DRAM_DATA[dram_bypass_px_offset + co]);
+    Stats.countDRAMRead();
+  }
+  DRAM_TRACE(DRAM_BYPASS_READ, &DRAM_DATA[dram_bypass_px_offset] - SHARED_DRAM,
+             (int)ch_out);
+}
+
 void MemoryController::writeBackResult(OutputCache *globalPoolCache) {
+  // Global Pooling accumulates over all output pixels of last layer
+  // -> optionally divide by #pixels here (width_out, height_out of last layer)
+  data_t num_pixels = (int)(width_out * height_out);
 L_writeBackResult:
   for (int i = 0; i < ch_out; i++) {  // ch_out set from last layer
-#pragma HLS LOOP_TRIPCOUNT min=1000 max=1000 avg=1000
+#pragma HLS LOOP_TRIPCOUNT min=NET_NUM_CLASSES max=NET_NUM_CLASSES \
+    avg=NET_NUM_CLASSES
 #pragma HLS pipeline
-    DRAM_DATA[i] = globalPoolCache->getChannel(i);
+    data_t result = globalPoolCache->getChannel(i);
+    if (GPOOL_AVERAGE_ON_FPGA) result = result / num_pixels;
+    DRAM_DATA[i] = result;
   }
+  DRAM_TRACE(DRAM_RESULT_WRITE, DRAM_DATA - SHARED_DRAM, (int)ch_out);
   LOG("MemoryCtrl: writeBackResult (%d Bytes) to DRAM @0\n",
       (int)(ch_out * sizeof(data_t)));
 }
+
+void MemoryController::writeBackTopK(OutputCache *globalPoolCache,
+                                     topk_t k) {
+  // Select k highest (averaged) global pooling results, write back as
+  // k (class, score) pairs + softmax normalizer sum_i(e^(score_i - max)):
+  //   DRAM_DATA[2*i] = class index (as data_t value), DRAM_DATA[2*i+1] = score
+  //   DRAM_DATA[2*k] = sum of exponentials over all ch_out classes
+  data_t num_pixels = (int)(width_out * height_out);
+  data_t top_score[MAX_TOPK];
+  channel_t top_class[MAX_TOPK];
+#pragma HLS ARRAY_PARTITION variable = top_score complete dim = 0
+#pragma HLS ARRAY_PARTITION variable = top_class complete dim = 0
+
+  if (k > ch_out) k = ch_out;
+
+L_TopK_init:
+  for (int j = 0; j < MAX_TOPK; j++) {
+#pragma HLS unroll
+    top_score[j] = -INFINITY;
+    top_class[j] = 0;
+  }
+
+  // Insertion into sorted list (top_score[0] = highest)
+L_TopK_select:
+  for (channel_t i = 0; i < ch_out; i++) {
+#pragma HLS LOOP_TRIPCOUNT min=NET_NUM_CLASSES max=NET_NUM_CLASSES \
+    avg=NET_NUM_CLASSES
+#pragma HLS pipeline
+    data_t score = globalPoolCache->getChannel(i) / num_pixels;
+  L_TopK_insert:
+    for (int j = MAX_TOPK - 1; j >= 0; j--) {
+#pragma HLS unroll
+      if (score > top_score[j]) {
+        if (j < MAX_TOPK - 1) {
+          top_score[j + 1] = top_score[j];
+          top_class[j + 1] = top_class[j];
+        }
+        if (j == 0 || !(score > top_score[j - 1])) {
+          top_score[j] = score;
+          top_class[j] = i;
+        }
+      }
+    }
+  }
+
+  // Softmax Normalizer (subtract maximum to avoid numerical issues)
+  data_t expsum = 0.0f;
+L_TopK_expsum:
+  for (channel_t i = 0; i < ch_out; i++) {
+#pragma HLS LOOP_TRIPCOUNT min=NET_NUM_CLASSES max=NET_NUM_CLASSES \
+    avg=NET_NUM_CLASSES
+#pragma HLS pipeline
+    data_t score = globalPoolCache->getChannel(i) / num_pixels;
+    expsum += std::exp(score - top_score[0]);
+  }
+
+  // Write Back (class, score) pairs + normalizer
+L_TopK_writeBack:
+  for (topk_t j = 0; j < k; j++) {
+#pragma HLS LOOP_TRIPCOUNT min=5 max=16 avg=5
+#pragma HLS pipeline
+    DRAM_DATA[2 * j] = (data_t)top_class[j];
+    DRAM_DATA[2 * j + 1] = top_score[j];
+    LOG(" - top %2d: class %4d, score %6.2f\n", (int)j, (int)top_class[j],
+        top_score[j]);
+  }
+  DRAM_DATA[2 * k] = expsum;
+  DRAM_TRACE(DRAM_RESULT_WRITE, DRAM_DATA - SHARED_DRAM, 2 * (int)k + 1);
+
+  LOG("MemoryCtrl: writeBackTopK (top-%d of %d classes) to DRAM @0\n", (int)k,
+      (int)ch_out);
+}
+
+// ========================
+// = Performance Counters =
+// ========================
+PerfCounters &MemoryController::perfCounters() { return Stats; }
+
+void MemoryController::writeBackPerfCounters(layerid_t layer_id) {
+  // Counters of one Layer as uint32 in float (same as layer config)
+  if (!stats_enabled) return;
+  union { float f; unsigned int i; } u;
+L_writeBackPerfCounters:
+  for (int c = 0; c < NUM_PERF_COUNTERS; c++) {
+#pragma HLS pipeline
+    u.i = Stats.get((perfcounter_t)c);
+    DRAM_STATS[layer_id * NUM_PERF_COUNTERS + c] = u.f;
+  }
+  DRAM_TRACE(DRAM_STATS_WRITE,
+             &DRAM_STATS[layer_id * NUM_PERF_COUNTERS] - SHARED_DRAM,
+             NUM_PERF_COUNTERS);
+  LOG("MemoryCtrl: writeBackPerfCounters (layer %d, %d iterations)\n",
+      (int)layer_id, (int)Stats.get(PERF_ITERATIONS));
+}
@@ -16,36 +16,67 @@
 // Data Types for FPGA Implementation
 #include "fpga_top.hpp"
 #include "output_cache.hpp"
+#include "perf_counters.hpp"
+#include "dram_trace.hpp"
+
+// =====================
+// = Shared DRAM Depth =
+// =====================
+// DRAM_DEPTH (network.hpp, m_axi depth of SHARED_DRAM in floats) is what
+// allocate_FPGA_memory() allocates for NET_LAYERS: layer config + weights +
+// NUM_JOB_SLOTS x (data section + performance counters)
+#if NET_DESC_CHECKS
+NET_CHECK(DRAM_DEPTH, netDramDepth(NET_LAYERS, NET_PLAN, MEMORY_ALIGNMENT,
+                                   NUM_JOB_SLOTS, NUM_PERF_COUNTERS));
+static_assert(DRAM_DEPTH <= (1 << MEMADDR_BITS),
+              "DRAM_DEPTH: addresses exceed memaddr_t");
+#endif
 
 // =====================
 // = Memory Controller =
 // =====================
 class MemoryController {
  public:
+  // stats_offset: per-layer performance counters (0 = not written back)
   MemoryController(data_t *mempointer, unsigned int weights_offset,
-                   unsigned int data_offset);
+                   unsigned int data_offset, unsigned int stats_offset = 0);
   void loadConfig(int num_layers, layer_t *configBRAM);
   void setLayerConfig(layer_t &layer);
   data_t loadNextWeight();
   void setPixelLoadRow(coordinate_t y);
   data_t loadNextChannel();
+  void setOutputPixel(coordinate_t y_out, coordinate_t x_out);
+  void storeNextChannel(data_t value);
   void writeBackOutputPixel(coordinate_t y_out, coordinate_t x_out,
                             OutputCache *outputCache);
+  void loadBypassPixel(coordinate_t y_out, coordinate_t x_out,
+                       OutputCache *bypassCache);
   void writeBackResult(OutputCache *globalPoolCache);
+  void writeBackTopK(OutputCache *globalPoolCache, topk_t k);
+  PerfCounters &perfCounters();
+  void writeBackPerfCounters(layerid_t layer_id);
 
  private:
   data_t *const SHARED_DRAM;
   data_t *DRAM_DATA;
   data_t *DRAM_WEIGHTS;
+  data_t *DRAM_STATS;
+  bool stats_enabled;
+  PerfCounters Stats;
   memaddr_t dram_weights_offset;
   memaddr_t dram_input_offset;
   memaddr_t dram_output_offset;
   memaddr_t dram_pixel_offset;
+  memaddr_t dram_output_px_offset;
+  memaddr_t dram_bypass_offset;
   pixelperrow_t pixels_per_row;
   dimension_t width_out;
+  dimension_t height_out;
   channel_t ch_out;
-  bool is_expand_layer;
+  channel_t out_pixel_stride;
+  channel_t out_channel_offset;
 
+  memaddr_t outputPixelOffset(coordinate_t y_out, coordinate_t x_out);
   void loadConfigViaFloatUnion(int num_layers, layer_t *configBRAM);
   void floatsToLayerT(float floats[NUM_FLOATS_PER_LAYER], layer_t &layer);
 };
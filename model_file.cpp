@@ -0,0 +1,275 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  model_file.cpp
+//
+//  loadModelFile(), saveModelFile(), checkNetworkLimits()
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "model_file.hpp"
+#include "fpga_top.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ==========================================
+// = Load Network + Weights from Model File =
+// ==========================================
+
+// Raw int32 Fields of one Layer, checked before they become layer_t /
+// addConcatLayer() arguments (narrow index types would wrap, stride 0
+// divides by zero). Dimensions + Channels: within the limits of network.hpp
+// (check_limits = false: within the bit-widths of layer_t, to autotune)
+static bool validModelLayer(const model_layer_t *l, int index,
+                            bool check_limits) {
+  int max_dim = check_limits ? MAX_DIMENSION : (1 << NBITS(MAX_DIMENSION)) - 1;
+  int max_ch =
+      check_limits ? MAX_CHANNELS : (1 << NBITS(MAX_CHANNELS + 9)) - 1;
+  bool valid_type = (l->type == LAYER_CONV) &&
+                    (l->pool >= POOL_NONE && l->pool <= POOL_3x3S2);
+  bool valid_shape = (l->kernel == 1 || l->kernel == 3) &&
+                     (l->stride == 1 || l->stride == 2) &&
+                     (l->pad == 0 || l->pad == 1) &&
+                     (l->width >= 1 && l->width <= max_dim) &&
+                     (l->height >= 1 && l->height <= max_dim);
+  bool valid_channels =
+      (l->channels_in >= 1 && l->channels_in <= max_ch) &&
+      (l->channels_out >= 1 && l->channels_out <= max_ch) &&
+      (l->concat_channels >= l->channels_out && l->concat_channels <= max_ch) &&
+      (l->groups >= 1 && l->channels_in % l->groups == 0 &&
+       l->channels_out % l->groups == 0);
+  bool valid_links = (l->bypass_layer >= -1 && l->bypass_layer < index) &&
+                     (l->input_layer >= -1 && l->input_layer < index) &&
+                     (l->concat_layer >= -1 && l->concat_layer < index) &&
+                     (l->new_output_map == 0 || l->new_output_map == 1) &&
+                     (index > 0 || l->new_output_map) &&
+                     (l->concat_layer == -1 || !l->new_output_map);
+  return valid_type && valid_shape && valid_channels && valid_links;
+}
+
+network_t *loadModelFile(const char *filename, bool check_limits) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    printf("ERROR: File %s could not be opened!\n", filename);
+    exit(-1);
+  }
+  struct stat filestat;
+  fstat(fd, &filestat);
+  long filesize = filestat.st_size;
+
+  // Map whole File (private: weights may be modified without touching file)
+  char *file = (char *)mmap(NULL, filesize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (filesize < (long)sizeof(model_header_t) || file == MAP_FAILED) {
+    printf("ERROR: File %s could not be mapped!\n", filename);
+    exit(-1);
+  }
+
+  // Check Header
+  model_header_t *header = (model_header_t *)file;
+  long table_end = (long)header->layer_table_offset +
+                   (long)header->num_layers * sizeof(model_layer_t);
+  long weights_end = (long)header->weights_offset +
+                     (long)header->num_weights * sizeof(data_t);
+  if (memcmp(header->magic, MODEL_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != MODEL_FILE_VERSION ||
+      header->layer_size != sizeof(model_layer_t) || table_end > filesize ||
+      weights_end > filesize ||
+      header->layer_table_offset % sizeof(int32_t) != 0 ||
+      header->weights_offset % MODEL_FILE_ALIGNMENT != 0) {
+    printf("ERROR: %s is not a valid model file (version %d)!\n", filename,
+           (int)MODEL_FILE_VERSION);
+    exit(-1);
+  }
+  if (header->num_layers < 1 || header->num_layers > MAX_NUM_LAYERS) {
+    printf("ERROR: Model has %d layers, this build supports 1..%d!\n",
+           (int)header->num_layers, MAX_NUM_LAYERS);
+    exit(-1);
+  }
+
+  // Weights: use mapped File directly
+  network_t *net = new network_t(header->num_layers, 0);
+  free(net->weights);
+  net->weights = (data_t *)(file + header->weights_offset);
+  net->num_weights = header->num_weights;
+
+  // Rebuild Layer List (-> plans activation memory, exits on inconsistent
+  // concatenations / bypasses / input shapes, see addConcatLayer())
+  model_layer_t *table = (model_layer_t *)(file + header->layer_table_offset);
+  for (int i = 0; i < (int)header->num_layers; i++) {
+    model_layer_t *l = &table[i];
+    char name[NET_NAME_MAX_LEN + 1];
+    strncpy(name, l->name, NET_NAME_MAX_LEN);
+    name[NET_NAME_MAX_LEN] = 0;
+    if (!validModelLayer(l, i, check_limits)) {
+      printf("ERROR: Invalid configuration of layer %d (%s) in %s!\n", i,
+             name, filename);
+      exit(-1);
+    }
+    layer_t layer(name, (layertype_t)l->type, l->width, l->height,
+                  l->channels_in, l->channels_out, l->kernel, l->pad,
+                  l->stride);
+    addConcatLayer(net, layer, l->concat_channels, l->new_output_map,
+                   (pooltype_t)l->pool, l->groups, l->bypass_layer,
+                   l->input_layer, l->concat_layer);
+  }
+
+  // Weights of all Layers must be contained in File
+  layer_t *last = &net->layers[net->num_layers - 1];
+  int weights_needed = last->mem_addr_weights +
+                       (last->channels_out / last->groups) *
+                           last->channels_in * last->kernel * last->kernel +
+                       last->channels_out;
+  if (weights_needed > net->num_weights) {
+    printf("ERROR: Model needs %d weights, %s contains only %d!\n",
+           weights_needed, filename, net->num_weights);
+    exit(-1);
+  }
+
+  if (!checkNetworkLimits(net)) {
+    printf("%s: Model %s does not fit into this build (network.hpp)!\n",
+           check_limits ? "ERROR" : "WARNING", filename);
+    if (check_limits) exit(-1);
+  }
+
+  printf("CPU: Loaded Model %s: %d layers, %d weights\n", filename,
+         (int)net->num_layers, net->num_weights);
+  return net;
+}
+
+// ========================================
+// = Save Network + Weights to Model File =
+// ========================================
+
+void saveModelFile(network_t *net, const char *filename) {
+  FILE *filehandle = fopen(filename, "wb");
+  if (!filehandle) {
+    printf("ERROR: File %s could not be opened!\n", filename);
+    exit(-1);
+  }
+
+  // Header
+  model_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic));
+  header.version = MODEL_FILE_VERSION;
+  header.header_size = sizeof(model_header_t);
+  header.num_layers = net->num_layers;
+  header.layer_size = sizeof(model_layer_t);
+  header.layer_table_offset = sizeof(model_header_t);
+  header.num_weights = net->num_weights;
+  int table_end = sizeof(model_header_t) +
+                  (int)net->num_layers * sizeof(model_layer_t);
+  header.weights_offset = (table_end + MODEL_FILE_ALIGNMENT - 1) /
+                          MODEL_FILE_ALIGNMENT * MODEL_FILE_ALIGNMENT;
+  fwrite(&header, sizeof(header), 1, filehandle);
+
+  // Layer Table: recover addConcatLayer() arguments from tensor bookkeeping
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    model_layer_t l;
+    memset(&l, 0, sizeof(l));
+    strncpy(l.name, layer->name, sizeof(l.name));
+    l.type = layer->type;
+    l.width = layer->width;
+    l.height = layer->height;
+    l.channels_in = layer->channels_in;
+    l.channels_out = layer->channels_out;
+    l.kernel = layer->kernel;
+    l.pad = layer->pad;
+    l.stride = layer->stride;
+    l.concat_channels = layer->out_pixel_stride;
+    l.pool = layer->pool;
+    l.groups = layer->groups;
+    l.bypass_layer = -1;
+    for (int j = 0; j < i && net->bypass_tensor[i] >= 0; j++) {
+      if (net->input_tensor[j] == net->bypass_tensor[i]) {
+        l.bypass_layer = j;
+        break;
+      }
+    }
+    // Output: new map, or concatenated to the map of the last layer writing
+    // it. Input: default (see addConcatLayer()), or output of a layer
+    l.new_output_map = 1;
+    l.concat_layer = -1;
+    for (int j = i - 1; j >= 0 && l.new_output_map; j--) {
+      if (net->output_tensor[j] == net->output_tensor[i]) {
+        l.new_output_map = 0;
+        l.concat_layer = (j == i - 1) ? -1 : j;
+      }
+    }
+    int default_input = (i == 0) ? 0
+                        : l.new_output_map ? net->output_tensor[i - 1]
+                                           : net->input_tensor[i - 1];
+    l.input_layer = -1;
+    for (int j = 0; j < i && net->input_tensor[i] != default_input; j++) {
+      if (net->output_tensor[j] == net->input_tensor[i]) {
+        l.input_layer = j;
+        break;
+      }
+    }
+    fwrite(&l, sizeof(l), 1, filehandle);
+  }
+
+  // Padding + Weights
+  for (int i = table_end; i < (int)header.weights_offset; i++)
+    fputc(0, filehandle);
+  fwrite(net->weights, sizeof(data_t), net->num_weights, filehandle);
+
+  fclose(filehandle);
+  printf("CPU: Saved Model %s: %d layers, %d weights\n", filename,
+         (int)net->num_layers, net->num_weights);
+}
+
+// ==============================================
+// = Check Network against Limits of this Build =
+// ==============================================
+
+bool checkNetworkLimits(network_t *net) {
+  bool fits = (net->num_layers <= MAX_NUM_LAYERS);
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    int ch_in = layer->channels_in;
+    int ch_out = layer->channels_out;
+    int num_weights = (ch_out / layer->groups) * ch_in * layer->kernel *
+                          layer->kernel +
+                      ch_out;
+    int width_out = (int)layer->width / (int)layer->stride;
+    int pool_line = pooled_dimension(width_out, layer->pool) * ch_out;
+    bool max_pool = (layer->pool == POOL_2x2S2 || layer->pool == POOL_3x3S2);
+
+    const char *problem = NULL;
+    if (layer->width > MAX_DIMENSION || layer->height > MAX_DIMENSION)
+      problem = "MAX_DIMENSION";
+    else if (ch_in > MAX_CHANNELS || layer->out_pixel_stride > MAX_CHANNELS)
+      problem = "MAX_CHANNELS";
+    else if (ch_out > MAX_NUM_CHOUT)
+      problem = "MAX_NUM_CHOUT";
+    else if (num_weights > MAX_WEIGHTS_PER_LAYER)
+      problem = "MAX_WEIGHTS_PER_LAYER";
+    else if (NUM_IMG_CACHE_LINES * layer->width * ch_in > MAX_IMAGE_CACHE_SIZE)
+      problem = "MAX_IMAGE_CACHE_SIZE";
+    else if (max_pool && 2 * pool_line > MAX_POOL_CACHE_SIZE)
+      problem = "MAX_POOL_CACHE_SIZE";
+    else if (ch_in % layer->groups != 0 || ch_out % layer->groups != 0)
+      problem = "GROUPS (must divide channels)";
+    else if ((layer->kernel != 1 && layer->kernel != 3) ||
+             (layer->stride != 1 && layer->stride != 2) ||
+             layer->pad != (layer->kernel == 3))
+      problem = "LAYER VARIANTS (kernel 1/3, stride 1/2, 'same' pad)";
+
+    if (problem) {
+      printf("ERROR: Layer %d (%s) exceeds %s\n", i, layer->name, problem);
+      fits = false;
+    }
+  }
+  return fits;
+}
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  model_file.hpp
+//
+//  Single-File Model Container (Network Topology + Weights), mmap Loader
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef MODEL_FILE_HPP_D4E1A7C3
+#define MODEL_FILE_HPP_D4E1A7C3
+
+#include <stdint.h>
+#include "network.hpp"
+#include "netconfig.hpp"
+
+// =====================
+// = Model File Format =
+// =====================
+// Binary File (little endian), written by convert_caffemodel.py or
+// saveModelFile():
+//      ______________
+//     |    header    |  0
+//     |______________|  (model_header_t)
+//     | layer table  |  layer_table_offset
+//     |              |  (num_layers x model_layer_t)
+//     |______________|
+//     |   padding    |
+//     |______________|
+//     |   weights    |  weights_offset (multiple of MODEL_FILE_ALIGNMENT)
+//     |              |  (num_weights x float, layers in order, as weights.bin)
+//     |______________|
+//
+// Memory addresses are not stored: the loader rebuilds the network with
+// addConcatLayer(), which plans the activation memory.
+const char MODEL_FILE_MAGIC[8] = {'S', 'Q', 'Z', 'M', 'O', 'D', 'E', 'L'};
+const uint32_t MODEL_FILE_VERSION = 2;  // 2: + input_layer, concat_layer
+const int MODEL_FILE_ALIGNMENT = 4096;  // weights start on page border (mmap)
+
+struct model_header_t {
+  char magic[8];                // MODEL_FILE_MAGIC
+  uint32_t version;             // MODEL_FILE_VERSION
+  uint32_t header_size;         // sizeof(model_header_t)
+  uint32_t num_layers;
+  uint32_t layer_size;          // sizeof(model_layer_t)
+  uint32_t layer_table_offset;  // Bytes from beginning of file
+  uint32_t num_weights;
+  uint32_t weights_offset;      // Bytes from beginning of file
+  uint32_t reserved;
+};
+
+// One Layer = Arguments of addConcatLayer()
+struct model_layer_t {
+  char name[8];
+  int32_t type;  // layertype_t
+  int32_t width;
+  int32_t height;
+  int32_t channels_in;
+  int32_t channels_out;
+  int32_t kernel;
+  int32_t pad;
+  int32_t stride;
+  int32_t concat_channels;  // channels per pixel in output feature map
+  int32_t new_output_map;   // 0 = concatenate to output of last layer
+  int32_t pool;             // pooltype_t
+  int32_t groups;
+  int32_t bypass_layer;  // -1 = no residual connection
+  int32_t input_layer;   // -1 = default input (see addConcatLayer())
+  int32_t concat_layer;  // -1 = concatenate to output of last layer
+};
+
+// ==========================================
+// = Load Network + Weights from Model File =
+// ==========================================
+// Maps file into memory (net->weights points directly into the mapping,
+// no intermediate copy) and rebuilds the layer list.
+// Exits if the file is invalid or exceeds the limits in network.hpp
+// (check_limits = false: only warn, e.g. to autotune a bigger model).
+network_t *loadModelFile(const char *filename, bool check_limits = true);
+
+// ========================================
+// = Save Network + Weights to Model File =
+// ========================================
+void saveModelFile(network_t *net, const char *filename);
+
+// ==============================================
+// = Check Network against Limits of this Build =
+// ==============================================
+// Returns false (and prints reason) if any layer exceeds the cache sizes /
+// bit-widths defined in network.hpp, or is no compiled layer variant of
+// fpga_top (processLayer<KERNEL, STRIDE, PAD>)
+bool checkNetworkLimits(network_t *net);
+
+#endif
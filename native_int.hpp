@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  native_int.hpp
+//
+//  Index Types: bit-accurate ap_(u)int or native int for fast C-Simulation
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef NATIVE_INT_HPP_A4F19D62
+#define NATIVE_INT_HPP_A4F19D62
+
+#include "ap_int.h"
+
+// ================================
+// = Index Types for C-Simulation =
+// ================================
+// Index types (dimension_t, channel_t, memaddr_t, coordinate_t, ...) are
+// declared with INDEX_UINT(W) / INDEX_INT(W):
+// - default (and always in synthesis): ap_uint<W> / ap_int<W>
+// - -DNATIVE_INT_TYPES (make fast): plain int, much faster C-Simulation
+//   (all index types have <= 31 bits, so int holds every valid value)
+// - -DNATIVE_INT_TYPES -DNATIVE_INT_RANGE_CHECK (make fastcheck): int that
+//   asserts on every assignment that the value fits into W bits (where the
+//   FPGA would silently wrap around)
+#if defined(NATIVE_INT_TYPES) && !defined(__SYNTHESIS__)
+
+#ifdef NATIVE_INT_RANGE_CHECK
+#include <cstdio>
+#include <cassert>
+
+template <int W, bool SIGNED>
+class range_checked_int {
+ public:
+  range_checked_int() : value(0) {}
+  range_checked_int(long long v) : value(check(v)) {}  // (also assignment)
+  template <int W2, bool SIGNED2>
+  range_checked_int(const range_checked_int<W2, SIGNED2> &v)
+      : value(check((int)v)) {}
+  operator int() const { return value; }
+  range_checked_int &operator+=(long long v) { return *this = value + v; }
+  range_checked_int &operator-=(long long v) { return *this = value - v; }
+  range_checked_int &operator*=(long long v) { return *this = value * v; }
+  range_checked_int &operator/=(long long v) { return *this = value / v; }
+  range_checked_int &operator%=(long long v) { return *this = value % v; }
+  range_checked_int &operator++() { return *this = value + 1; }
+  range_checked_int &operator--() { return *this = value - 1; }
+  range_checked_int operator++(int) {
+    range_checked_int old = *this;
+    *this = value + 1;
+    return old;
+  }
+  range_checked_int operator--(int) {
+    range_checked_int old = *this;
+    *this = value - 1;
+    return old;
+  }
+
+ private:
+  static int check(long long v) {
+    const long long min = SIGNED ? -(1LL << (W - 1)) : 0;
+    const long long max = SIGNED ? (1LL << (W - 1)) - 1 : (1LL << W) - 1;
+    if (v < min || v > max) {
+      fprintf(stderr, "ERROR: value %lld does not fit into %s<%d>!\n", v,
+              SIGNED ? "ap_int" : "ap_uint", W);
+      assert(false && "Index value out of range of FPGA bit width!");
+    }
+    return (int)v;
+  }
+  int value;
+};
+#define INDEX_UINT(W) range_checked_int<(W), false>
+#define INDEX_INT(W) range_checked_int<(W), true>
+
+#else
+#define INDEX_UINT(W) int
+#define INDEX_INT(W) int
+#endif
+
+#else
+#define INDEX_UINT(W) ap_uint<(W)>
+#define INDEX_INT(W) ap_int<(W)>
+#endif
+
+#endif /* end of include guard: NATIVE_INT_HPP_A4F19D62 */
@@ -12,32 +12,75 @@
 
 #include "network.hpp"
 #include "netconfig.hpp"
+#include "perf_model.hpp"
+#include <algorithm>
+#include <vector>
 
 // ==============================
 // = Add Layer to given Network =
 // ==============================
 
+// Inconsistent Layer Arguments (e.g. from a model file): report + exit
+// (also with NDEBUG, a wrong memory plan would corrupt neighbouring maps)
+static void checkLayer(bool valid, int layer_id, layer_t &layer,
+                       const char *problem) {
+  if (valid) return;
+  printf("ERROR: Invalid layer %d (%s): %s!\n", layer_id, layer.name,
+         problem);
+  exit(-1);
+}
+
+// Channels per Pixel of a planned Tensor (image: CH_IN of the first layer)
+static int tensorPixelStride(network_t *net, int tensor) {
+  if (tensor == 0) return net->layers[0].channels_in;
+  return net->layers[net->tensors[tensor].first_layer].out_pixel_stride;
+}
+
 void addLayer(network_t *net, layer_t layer, bool is_expand_layer,
-              bool update_memory_address, pooltype_t pool_type) {
+              bool update_memory_address, pooltype_t pool_type, int groups,
+              int bypass_layer) {
+  // If is_expand_layer==true, output is concatenated from 2 layers
+  //    (expand1x1 + expand3x3, each with channels_out) -> 2-way concat
+  int concat_channels =
+      is_expand_layer ? 2 * (int)layer.channels_out : (int)layer.channels_out;
+  addConcatLayer(net, layer, concat_channels, update_memory_address, pool_type,
+                 groups, bypass_layer);
+}
+
+void addConcatLayer(network_t *net, layer_t layer, int concat_channels,
+                    bool update_memory_address, pooltype_t pool_type,
+                    int groups, int bypass_layer, int input_layer,
+                    int concat_layer) {
   // Assumes that Network has been initialized with enough memory (not checked!)
-  // Uses static variables -> can only use for 1 network definitions!
-  // If update_memory_address==true, advances layer's memory addresses for input
-  //    and output memories and weights
-  // If is_expand_layer==true, reserves double amount of output memory to allow
-  //    implicit out-channel concatenation (use for expand1x1 layer)
-  // If is_expand_layer==true and update_memory_address==false, uses same input
-  //    memory address as in last layer, and only slightly shifted output
-  //    address (use for expand3x3 layer)
+  // If update_memory_address==true, layer reads the output feature map of the
+  //    last layer (or the input image) and writes a new output feature map
+  // CONCAT_CHANNELS = number of channels per pixel in output feature map
+  //    (> channels_out if several layers write into one concatenated map)
+  // If update_memory_address==false, uses same input + output feature map
+  //    as last layer, output channels are placed behind the last layer's
+  //    channels within each pixel (zero-copy out-channel concatenation)
+  // Use INPUT_LAYER >= 0 to read the output feature map of layer INPUT_LAYER
+  //    instead (e.g. 3x3 conv after a 1x1 reduce in an Inception branch)
+  // Use CONCAT_LAYER >= 0 (update_memory_address==false) to write into the
+  //    output feature map of layer CONCAT_LAYER instead of the last layer's,
+  //    behind all channels written into it so far
   // Use POOL_TYPE = POOL_GLOBAL in last layer to sum over spatial dimension
   //    (output becomes 1x1xCH_OUT)
+  // Use POOL_TYPE = POOL_2x2S2 or POOL_3x3S2 for fused max pooling
+  //    (output becomes pooled_dimension(width_out) x ... x CH_OUT)
+  // Use GROUPS > 1 for grouped / depthwise convolution
+  //    (each input channel only feeds CH_OUT / GROUPS output channels)
+  // Use BYPASS_LAYER >= 0 to add input feature map of layer BYPASS_LAYER
+  //    to the output before ReLU (residual connection, no max pooling)
+  // Memory addresses are assigned by planActivationMemory() (re-run below)
 
-  // Keep Track of Memory Locations for Activations + Weights (-> static)
-  static int next_activation_mem = 0;
-  static int last_activation_mem = 0;
-  static int next_weights_mem = 0;
+  int layer_id = net->num_layers;
 
-  // Align to memory borders (float needed because of ceil() operation below)
-  float mem_border = MEMORY_ALIGNMENT / sizeof(data_t);
+  // Grouped Conv: each group needs the same number of input + output channels
+  // (PE and WeightsCache address CH_IN / GROUPS, CH_OUT / GROUPS)
+  checkLayer(groups > 0 && layer.channels_in % groups == 0 &&
+                 layer.channels_out % groups == 0,
+             layer_id, layer, "GROUPS must divide CH_IN and CH_OUT");
 
   // Data Size Calculations
   int input_data_pixels = layer.width * layer.height * layer.channels_in;
@@ -49,58 +92,169 @@ void addLayer(network_t *net, layer_t layer, bool is_expand_layer,
       std::floor((float)(layer.height + 2 * layer.pad - layer.kernel) /
                  layer.stride) +
       1;
-  int output_data_pixels = width_out * height_out * layer.channels_out;
-  int num_weights =  // conv + bias weights
-      layer.channels_out * layer.channels_in * layer.kernel * layer.kernel +
-      layer.channels_out;
-
-  // Normal Layers:
-  // - increase "next_activation_mem" to next available (1MB) memory border
-  // Data + First Expand1x1 Layers:
-  // - do not increase memory addresses
-  if (update_memory_address) {  // "normal layer"
-
-    last_activation_mem = next_activation_mem;
-    // next free memory address = behind input of current layer
-    // input data size:
-    next_activation_mem += input_data_pixels;
-    // align to 1MB memory borders
-    next_activation_mem = ceil(next_activation_mem / mem_border) * mem_border;
+  if (pool_type == POOL_2x2S2 || pool_type == POOL_3x3S2) {
+    width_out = pooled_dimension(width_out, pool_type);
+    height_out = pooled_dimension(height_out, pool_type);
   }
+  // Global Pooling Layers only write the final result (not planned)
+  int output_data_pixels = (pool_type == POOL_GLOBAL)
+                               ? 0
+                               : width_out * height_out * concat_channels;
 
-  /*printf("layer %s, update_memory_address = %d, last_activation_mem = %d, "
-   "next_activation_mem = %d", layer.name, update_memory_address,
-   last_activation_mem, next_activation_mem);*/
+  // First Layer: Input Image is tensor 0
+  if (layer_id == 0) {
+    tensor_t image = {input_data_pixels, -1, -1, 0};
+    net->tensors[0] = image;
+    net->num_tensors = 1;
+  }
 
-  // Write Memory Addresses into Layer Config
-  layer.mem_addr_input = last_activation_mem;
-  layer.mem_addr_output = next_activation_mem;
-  layer.mem_addr_weights = next_weights_mem;
+  // Normal Layers:
+  // - read output of last layer (or of INPUT_LAYER), write to new tensor
+  // Concatenated Output (e.g. 2nd "expand" (expand3x3) layer):
+  // - will read from same input tensor as last layer (or output of
+  //   INPUT_LAYER)
+  // - will write to same output tensor as last layer (or CONCAT_LAYER),
+  //   behind all channels already written into it
+  checkLayer(input_layer < layer_id, layer_id, layer,
+             "input from unknown layer");
+  checkLayer(concat_layer < layer_id, layer_id, layer,
+             "concatenation to unknown layer");
+  bool new_output = update_memory_address || layer_id == 0;
+  if (layer_id == 0)
+    net->input_tensor[layer_id] = 0;
+  else if (input_layer >= 0)
+    net->input_tensor[layer_id] = net->output_tensor[input_layer];
+  else
+    net->input_tensor[layer_id] = new_output
+                                      ? net->output_tensor[layer_id - 1]
+                                      : net->input_tensor[layer_id - 1];
+  int channel_offset = 0;
+  if (new_output) {
+    tensor_t output = {output_data_pixels, layer_id, layer_id, 0};
+    net->output_tensor[layer_id] = net->num_tensors;
+    net->tensors[net->num_tensors++] = output;
+  } else {
+    int target = (concat_layer >= 0) ? concat_layer : layer_id - 1;
+    int output = net->output_tensor[target];
+    net->output_tensor[layer_id] = output;
+    for (int l = 0; l < layer_id; l++) {
+      layer_t *writer = &net->layers[l];
+      if (net->output_tensor[l] == output)
+        channel_offset = std::max(channel_offset,
+                                  (int)(writer->out_channel_offset +
+                                        writer->channels_out));
+    }
+    checkLayer(concat_channels == tensorPixelStride(net, output) &&
+                   output_data_pixels == net->tensors[output].size,
+               layer_id, layer, "concatenated output map has different shape");
+  }
+  checkLayer(channel_offset + layer.channels_out <= concat_channels, layer_id,
+             layer, "output channels exceed CONCAT_CHANNELS");
+  layer.out_pixel_stride = concat_channels;
+  layer.out_channel_offset = channel_offset;
+  checkLayer(net->input_tensor[layer_id] != net->output_tensor[layer_id],
+             layer_id, layer, "layer reads its own output feature map");
+  // ImageCache reads W x H pixels of exactly CH_IN channels
+  int input = net->input_tensor[layer_id];
+  checkLayer(layer_id == 0 || (net->tensors[input].size == input_data_pixels &&
+                               tensorPixelStride(net, input) ==
+                                   (int)layer.channels_in),
+             layer_id, layer, "input map has different shape");
+  net->tensors[net->input_tensor[layer_id]].last_layer = layer_id;
 
-  // Update next available Weights Memory Address for Layers which have Weights:
-  if (layer.type == LAYER_CONV) {
-    next_weights_mem += num_weights;
-    // do not align (weights can be read completely sequentially)
-    // next_weights_mem = ceil(next_weights_mem / mem_border) * mem_border;
+  // Residual Connection: read bypass feature map with same layout as output
+  // (e.g. 2nd "expand" layer reads the upper half of the bypass channels)
+  net->bypass_tensor[layer_id] = -1;
+  if (bypass_layer >= 0) {
+    checkLayer(bypass_layer < layer_id, layer_id, layer,
+               "bypass from unknown layer");
+    checkLayer(pool_type != POOL_2x2S2 && pool_type != POOL_3x3S2, layer_id,
+               layer, "bypass cannot be combined with max pooling");
+    // loadBypassPixel() reads the bypass map with the output map's layout
+    // (pixels of CONCAT_CHANNELS, W_OUT x H_OUT before global pooling)
+    int bypass = net->input_tensor[bypass_layer];
+    checkLayer(net->tensors[bypass].size ==
+                       width_out * height_out * concat_channels &&
+                   tensorPixelStride(net, bypass) == concat_channels,
+               layer_id, layer, "bypass map has different shape than output");
+    layer.has_bypass = true;
+    net->bypass_tensor[layer_id] = bypass;
+    net->tensors[bypass].last_layer = layer_id;
   }
 
-  // For 2nd "expand" (expand3x3) layer:
-  // - will read from same input location
-  // - will write to slightly offset memory location (interleave out channels)
-  if (is_expand_layer && !update_memory_address) {
-    layer.mem_addr_output = next_activation_mem + layer.channels_out;
+  // Weights are stored sequentially, in order of layers (not aligned)
+  layer.mem_addr_weights = 0;
+  if (layer_id > 0) {
+    layer_t *last_layer = &net->layers[layer_id - 1];
+    layer.mem_addr_weights = last_layer->mem_addr_weights;
+    if (last_layer->type == LAYER_CONV)
+      layer.mem_addr_weights +=
+          (last_layer->channels_out / last_layer->groups) *
+              last_layer->channels_in * last_layer->kernel *
+              last_layer->kernel +
+          last_layer->channels_out;
   }
 
   // Write Options into Layer Config
-  layer.is_expand_layer = is_expand_layer;
   layer.pool = pool_type;
+  layer.groups = groups;
 
-  // Add Layer to network
+  // Add Layer to network, update Memory Addresses of all Layers
   net->layers[net->num_layers] = layer;
   net->num_layers++;
-  net->total_pixel_mem = next_activation_mem + output_data_pixels;
+  planActivationMemory(net);
 };
 
+// ===================================
+// = Add Layer Table to given Network =
+// ===================================
+
+void addLayerTable(network_t *net, const layer_desc_t *layers,
+                   int num_layers) {
+  for (int i = 0; i < num_layers; i++) {
+    const layer_desc_t &d = layers[i];
+    layer_t layer(d.name, d.type, d.width, d.height, d.channels_in,
+                  d.channels_out, d.kernel, d.pad, d.stride);
+    addConcatLayer(net, layer, descConcatChannels(d), d.update_mem, d.pool,
+                   d.groups, d.bypass_layer, d.input_layer, d.concat_layer);
+  }
+}
+
+// ===========================================
+// = Plan Activation Memory of given Network =
+// ===========================================
+
+void planActivationMemory(network_t *net) {
+  int align = std::max(1, (int)(net->mem_alignment / sizeof(data_t)));
+  int num_layers = net->num_layers;
+  tensor_t *tensors = net->tensors;
+
+  // Same placement as the compile-time plan of NET_LAYERS (netdesc.hpp)
+  std::vector<int> scratch(2 * net->num_tensors);
+  planTensorAddresses(tensors, net->num_tensors, num_layers, align,
+                      scratch.data());
+
+  // Total Data Memory: all tensors + final result (written to address 0,
+  // up to 2 * CH_OUT + 1 floats for Top-K results)
+  int total = 0;
+  for (int t = 0; t < net->num_tensors; t++)
+    total = std::max(total, tensors[t].mem_addr + tensors[t].size);
+  if (num_layers > 0) {
+    int ch_out = net->layers[num_layers - 1].channels_out;
+    total = std::max(total, 2 * ch_out + 1);
+  }
+  net->total_pixel_mem = total;
+
+  // Write Memory Addresses into Layer Configs
+  for (int l = 0; l < num_layers; l++) {
+    layer_t *layer = &net->layers[l];
+    layer->mem_addr_input = tensors[net->input_tensor[l]].mem_addr;
+    layer->mem_addr_output = tensors[net->output_tensor[l]].mem_addr;
+    if (net->bypass_tensor[l] >= 0)
+      layer->mem_addr_bypass = tensors[net->bypass_tensor[l]].mem_addr;
+  }
+}
+
 // =================================
 // = Load Weights from Binary File =
 // =================================
@@ -119,9 +273,10 @@ void loadWeightsFromFile(network_t *net, const char *filename) {
       int chout = layer->channels_out;
       int chin = layer->channels_in;
       int kernel = layer->kernel;
+      int groups = layer->groups;
 
       // calculate address within weight memory section
-      int num_weights = chout * chin * kernel * kernel + chout;
+      int num_weights = (chout / groups) * chin * kernel * kernel + chout;
       float *weights_addr = (net->weights + layer->mem_addr_weights);
 
       // read portion of input file
@@ -150,8 +305,12 @@ void layer_to_floats(layer_t &layer, float floats[NUM_FLOATS_PER_LAYER]) {
   // memaddr_t mem_addr_input;
   // memaddr_t mem_addr_output;
   // memaddr_t mem_addr_weights;
-  // bool is_expand_layer;
+  // channel_t out_pixel_stride;
   // pooltype_t pool;
+  // channel_t groups;
+  // bool has_bypass;
+  // memaddr_t mem_addr_bypass;
+  // channel_t out_channel_offset;
 
   // clang-format off
   union { float f; unsigned int i; } u;
@@ -165,8 +324,12 @@ void layer_to_floats(layer_t &layer, float floats[NUM_FLOATS_PER_LAYER]) {
   u.i = layer.mem_addr_input;   floats[7] = u.f;
   u.i = layer.mem_addr_output;  floats[8] = u.f;
   u.i = layer.mem_addr_weights; floats[9] = u.f;
-  u.i = layer.is_expand_layer;  floats[10] = u.f;
-  u.i = (layer.pool == POOL_GLOBAL ? 1 : 0);  floats[11] = u.f;
+  u.i = layer.out_pixel_stride; floats[10] = u.f;
+  u.i = layer.pool;             floats[11] = u.f;
+  u.i = layer.groups;           floats[12] = u.f;
+  u.i = layer.has_bypass;       floats[13] = u.f;
+  u.i = layer.mem_addr_bypass;  floats[14] = u.f;
+  u.i = layer.out_channel_offset; floats[15] = u.f;
   // clang-format on
 }
 
@@ -185,9 +348,9 @@ void layer_to_floats(layer_t &layer, float floats[NUM_FLOATS_PER_LAYER]) {
 
 void print_layer(layer_t *layer) {
   int memory_needed = layer->height * layer->width * layer->channels_in;
-  int weights_size =
-      layer->kernel * layer->kernel * layer->channels_in * layer->channels_out +
-      layer->channels_out;
+  int weights_size = layer->kernel * layer->kernel * layer->channels_in *
+                         (layer->channels_out / layer->groups) +
+                     layer->channels_out;
 
   printf("%6s: IN %3d x %3d x %3d @mem(%6lu-%6lu" unit "B), OUT @mem(%6lu" unit
          "B)",
@@ -199,18 +362,27 @@ void print_layer(layer_t *layer) {
 
   printf(", CONV (%dx%d)/%d%s", (int)layer->kernel, (int)layer->kernel,
          (int)layer->stride, layer->pad ? "p" : " ");
+  if (layer->groups > 1 && layer->groups == layer->channels_in)
+    printf(" DW");
+  else if (layer->groups > 1)
+    printf(" G%d", (int)layer->groups);
   printf(", PARAM @mem(%4lu-%4lu" unit "B)",
          long(layer->mem_addr_weights * sizeof(float) / divi),
          long((layer->mem_addr_weights + weights_size) * sizeof(float) / divi));
-  if (layer->is_expand_layer)
-    printf(" (exact out %8lu B)", long(layer->mem_addr_output * sizeof(float)));
+  if (layer->out_pixel_stride != layer->channels_out)
+    printf(" (CONCAT ch %d-%d of %d)", (int)layer->out_channel_offset,
+           (int)(layer->out_channel_offset + layer->channels_out - 1),
+           (int)layer->out_pixel_stride);
+  if (layer->has_bypass)
+    printf(" + BYPASS @mem(%6lu" unit "B)",
+           long(layer->mem_addr_bypass * sizeof(float) / divi));
   if (layer->pool == POOL_GLOBAL) {
     printf(" POOL GLOBAL");
-  } /*else if (layer->pool == POOL_3x3S2) {
-   printf(" POOL 3x3/S2");
-   } else if (layer->pool == POOL_2x2S2) {
-   printf(" POOL 2x2/S2");
-   }*/
+  } else if (layer->pool == POOL_3x3S2) {
+    printf(" POOL 3x3/S2");
+  } else if (layer->pool == POOL_2x2S2) {
+    printf(" POOL 2x2/S2");
+  }
   printf("\n");
 };
 
@@ -219,4 +391,7 @@ void print_layers(network_t *net) {
     layer_t *layer = &net->layers[i];
     print_layer(layer);
   }
+  // Estimated Cost (see perf_model.hpp)
+  printf("\n");
+  printPerformanceTable(net, defaultPerfArch(), stdout);
 }
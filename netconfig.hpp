@@ -16,7 +16,10 @@
 #include <string>
 #include <cmath>
 #include <cstdlib>
+#include <cassert>
 #include "ap_int.h"
+#include "native_int.hpp"  // INDEX_UINT(W), INDEX_INT(W)
+#include "netdesc.hpp"     // constants, enums, tensor_t, layer_desc_t
 
 // ================================
 // = Bit-Width Calculation MACROs =
@@ -29,13 +32,47 @@
 #define NBITS32(n) ((n & 0xFFFF0000) ? (16 + NBITS16(n >> 16)) : (NBITS16(n)))
 #define NBITS(n) ((n) == 0 ? 1 : NBITS32((n)) + 1)
 
-// =================================
-// = Network-Independent Constants =
-// =================================
-const int NET_NAME_MAX_LEN = 6;            // max length of layer names
-const int MEMORY_ALIGNMENT = 1024 * 1024;  // align data in DRAM to 1MB borders
-// floats needed to hold one layer_t (for conversion layer_t <-> float array):
-const int NUM_FLOATS_PER_LAYER = 12;
+// =========================================
+// = Check Network Constants against Table =
+// =========================================
+// Host builds (C++14, see netdesc.hpp) derive all constants of network.hpp
+// from the layer table NET_LAYERS: a mismatch, or a table that does not fit
+// this build (layer variant, concatenation, bypass), is a compile error
+// ! need to include network.hpp first!
+#if NET_DESC_TABLE
+const int NET_NUM_LAYERS = sizeof(NET_LAYERS) / sizeof(layer_desc_t);
+#endif
+#if NET_DESC_CHECKS
+constexpr net_plan_t<NET_NUM_LAYERS> NET_PLAN =
+    netPlan(NET_LAYERS, MEMORY_ALIGNMENT);
+static_assert(NET_PLAN.valid,
+              "NET_LAYERS: unsupported layer, concatenation or bypass");
+
+#define NET_CHECK(constant, derived) \
+  static_assert((constant) == (derived), #constant " != NET_LAYERS")
+NET_CHECK(MAX_NUM_LAYERS, NET_NUM_LAYERS);
+NET_CHECK(MAX_WEIGHTS_PER_LAYER, netMax(NET_LAYERS, descNumWeights));
+NET_CHECK(MAX_INPUT_PER_LAYER, netMax(NET_LAYERS, attrInputSize));
+NET_CHECK(MAX_NUM_CHOUT, netMax(NET_LAYERS, attrChannelsOut));
+NET_CHECK(MAX_DIMENSION, netMax(NET_LAYERS, attrDimension));
+NET_CHECK(MAX_CHANNELS, netMax(NET_LAYERS, attrChannels));
+NET_CHECK(MAX_POOL_CACHE_SIZE, netMax(NET_LAYERS, attrPoolCacheSize));
+
+NET_CHECK(TOTAL_NUM_WEIGHTS, NET_PLAN.total_weights);
+NET_CHECK(TOTAL_NUM_INPUTS, netSum(NET_LAYERS, attrInputSize));
+NET_CHECK(TOTAL_NUM_OUTPUTS, netSum(NET_LAYERS, attrOutputPixels));
+NET_CHECK(TOTAL_DRAM_IO,
+          TOTAL_NUM_WEIGHTS + TOTAL_NUM_INPUTS + TOTAL_NUM_OUTPUTS);
+
+NET_CHECK(MIN_DIMENSION, netMin(NET_LAYERS, attrDimension));
+NET_CHECK(AVG_DIMENSION, netAvg(NET_LAYERS, attrDimension));
+NET_CHECK(MIN_CHANNELS_IN, netMin(NET_LAYERS, attrChannelsIn));
+NET_CHECK(MAX_CHANNELS_IN, netMax(NET_LAYERS, attrChannelsIn));
+NET_CHECK(AVG_CHANNELS_IN, netAvg(NET_LAYERS, attrChannelsIn));
+NET_CHECK(MIN_NUM_CHOUT, netMin(NET_LAYERS, attrChannelsOut));
+NET_CHECK(AVG_NUM_CHOUT, netAvg(NET_LAYERS, attrChannelsOut));
+NET_CHECK(NET_NUM_CLASSES, NET_LAYERS[NET_NUM_LAYERS - 1].channels_out);
+#endif
 
 // ============================
 // = Network Type-Definitions =
@@ -43,32 +80,17 @@ const int NUM_FLOATS_PER_LAYER = 12;
 
 // Chose Bit-Vectors ideally wide for their contents
 // -> adapts to specific Network with definitions in network.hpp
-// ! need to include network.hpp first!
-typedef ap_uint<NBITS(MAX_DIMENSION)> dimension_t;
-typedef ap_uint<NBITS(MAX_CHANNELS + 9)> channel_t;
-typedef ap_uint<NBITS(MAX_WEIGHTS_PER_LAYER)> weightaddr_t;
-typedef ap_uint<NBITS(MAX_NUM_LAYERS)> numlayers_t;    // saves number of layers
-typedef ap_uint<NBITS(MAX_NUM_LAYERS - 1)> layerid_t;  // counts to num_layers-1
-typedef ap_uint<23> memaddr_t;  // must remain <= 23 bits to fit into float
-typedef ap_uint<2> kernel_t;    // =1 or =3
-typedef ap_uint<2> stride_t;    // =1 or =2
+typedef INDEX_UINT(NBITS(MAX_DIMENSION)) dimension_t;
+typedef INDEX_UINT(NBITS(MAX_CHANNELS + 9)) channel_t;
+typedef INDEX_UINT(NBITS(MAX_WEIGHTS_PER_LAYER)) weightaddr_t;
+// numlayers_t saves number of layers, layerid_t counts to num_layers-1
+typedef INDEX_UINT(NBITS(MAX_NUM_LAYERS)) numlayers_t;
+typedef INDEX_UINT(NBITS(MAX_NUM_LAYERS - 1)) layerid_t;
+typedef INDEX_UINT(MEMADDR_BITS) memaddr_t;  // <= 23 bits to fit into float
+typedef INDEX_UINT(2) kernel_t;    // =1 or =3
+typedef INDEX_UINT(2) stride_t;    // =1 or =2
 typedef float data_t;
 
-typedef enum {
-  LAYER_CONV,
-  LAYER_NONE  // not really used...
-  // LAYER_RELU,  // implicit after LAYER_CONV
-  // LAYER_DATA,  // implicit before first and after last layer
-  // LAYER_POOL,  // not supported, use all-convolutional networks
-} layertype_t;
-
-typedef enum {
-  POOL_NONE,
-  POOL_GLOBAL
-  // POOL_2x2S2,  // not supported, use all-convolutional networks
-  // POOL_3x3S2,  // not supported, use all-convolutional networks
-} pooltype_t;
-
 // ==================
 // = Struct LAYER_T =
 // ==================
@@ -86,9 +108,14 @@ struct layer_t {
   memaddr_t mem_addr_input;
   memaddr_t mem_addr_output;
   memaddr_t mem_addr_weights;
-  bool is_expand_layer;
+  channel_t out_pixel_stride;    // channels per pixel in output feature map
+  channel_t out_channel_offset;  // (> channels_out: concatenated output)
   // ap_uint<31> dummy;
   pooltype_t pool;
+  channel_t groups;  // grouped conv: each group of (CI / groups) input ch.
+                     // feeds (CO / groups) output ch. (=CI: depthwise conv)
+  bool has_bypass;   // residual connection: add feature map before ReLU
+  memaddr_t mem_addr_bypass;  // (same shape + layout as output feature map)
   // full constructor, used to define network in network.cpp
   layer_t(const char *n, layertype_t t, int w, int h, int ci, int co, int k,
           int p, int s, int mem_i = 0, int mem_o = 0, int mem_w = 0,
@@ -104,8 +131,12 @@ struct layer_t {
         mem_addr_input(mem_i),
         mem_addr_output(mem_o),
         mem_addr_weights(mem_w),
-        is_expand_layer(is_expand),
-        pool(pool) {
+        out_pixel_stride(is_expand ? 2 * co : co),
+        out_channel_offset(0),
+        pool(pool),
+        groups(1),
+        has_bypass(false),
+        mem_addr_bypass(0) {
     for (int i = 0; i < NET_NAME_MAX_LEN; i++) {
       name[i] = n[i];
       if (n[i] == 0) break;
@@ -125,8 +156,12 @@ struct layer_t {
         mem_addr_input(0),
         mem_addr_output(0),
         mem_addr_weights(0),
-        is_expand_layer(0),
-        pool(POOL_NONE) {
+        out_pixel_stride(0),
+        out_channel_offset(0),
+        pool(POOL_NONE),
+        groups(1),
+        has_bypass(false),
+        mem_addr_bypass(0) {
     name[0] = 0;
   };
 };
@@ -150,13 +185,28 @@ struct network_t {
   data_t *weights;
   int num_weights;
   int total_pixel_mem;
+  // Activation Memory Plan (kept up to date by addLayer()):
+  tensor_t *tensors;   // tensors[0] = input image (pinned to address 0)
+  int num_tensors;
+  int *input_tensor;   // tensor read by layer i
+  int *output_tensor;  // tensor written by layer i
+  int *bypass_tensor;  // tensor added by layer i (-1 = no bypass)
+  int mem_alignment;   // alignment of tensors in DRAM (Bytes)
   // default constructor: need to give max_layers and max_weights
   // allocates layers[max_layers] and weights[max_weights] on Heap
   // -> can only be used on CPU, not on FPGA
   network_t(int max_layers, int max_weights)
-      : num_layers(0), num_weights(0), total_pixel_mem(0) {
+      : num_layers(0),
+        num_weights(0),
+        total_pixel_mem(0),
+        num_tensors(0),
+        mem_alignment(MEMORY_ALIGNMENT) {
     layers = (layer_t *)malloc((sizeof(layer_t)) * max_layers);
     weights = (float *)malloc((sizeof(float)) * max_weights);
+    tensors = (tensor_t *)malloc((sizeof(tensor_t)) * (max_layers + 1));
+    input_tensor = (int *)malloc((sizeof(int)) * max_layers);
+    output_tensor = (int *)malloc((sizeof(int)) * max_layers);
+    bypass_tensor = (int *)malloc((sizeof(int)) * max_layers);
   }
 };
 
@@ -170,18 +220,66 @@ void print_layer(layer_t *layer);
 // = Add Layer to given Network =
 // ==============================
 // Assumes that Network has been allocated with enough memory (not checked!)
-// If update_memory_address==true, advances layer's memory addresses for input
-//    and output memories and weights
+// Memory addresses of all feature maps are re-planned after each added layer
+//    (see planActivationMemory())
+// If update_memory_address==true, layer reads the output of the last layer
+//    and writes a new output feature map
 // If is_expand_layer==true, reserves double amount of output memory to allow
 //    implicit out-channel concatenation (use for expand1x1 layer)
 // If is_expand_layer==true and update_memory_address==false, uses same input
-//    memory address as in last layer, and only slightly shifted output address
-//    (use for expand3x3 layer)
+//    and output memory address as in last layer, but writes the upper half of
+//    the output channels (use for expand3x3 layer)
 // Use POOL_TYPE = POOL_GLOBAL in last layer to sum over spatial dimension
-//    (output becomes 1x1xCH_OUT)
+//    (output becomes 1x1xCH_OUT, only this result is written back to DRAM)
+// Use POOL_TYPE = POOL_2x2S2 or POOL_3x3S2 for max pooling after CONV+ReLU
+//    (only pooled output pixels are written back to DRAM)
+// Use GROUPS > 1 for grouped convolution, GROUPS = CH_IN = CH_OUT for
+//    depthwise convolution (weights: [CI][CO / GROUPS][KY][KX])
+// Use BYPASS_LAYER >= 0 for a residual connection: the input feature map of
+//    layer BYPASS_LAYER is added to the output before ReLU (needs identical
+//    shape and layout as the output, e.g. same expand / concat structure)
 void addLayer(network_t *net, layer_t layer, bool is_expand_layer = false,
               bool update_memory_address = true,
-              pooltype_t pool_type = POOL_NONE);
+              pooltype_t pool_type = POOL_NONE, int groups = 1,
+              int bypass_layer = -1);
+
+// ====================================
+// = Add Layer Table to given Network =
+// ====================================
+// Adds all NUM_LAYERS rows of a layer table (NET_LAYERS in network.hpp)
+// with addConcatLayer(), resulting memory plan equals NET_PLAN
+void addLayerTable(network_t *net, const layer_desc_t *layers, int num_layers);
+
+// =======================================================
+// = Add Layer with Concatenated Output to given Network =
+// =======================================================
+// Generalization of addLayer() for N-way out-channel concatenation:
+// CONCAT_CHANNELS = total channels per pixel of concatenated output map
+// update_memory_address==true: first layer of concatenation (new output map)
+// update_memory_address==false: same input + output map as last layer,
+//    writes the channels behind those of the last layer
+// INPUT_LAYER >= 0: reads the output map of layer INPUT_LAYER instead
+// CONCAT_LAYER >= 0 (update_memory_address==false): writes into the output
+//    map of layer CONCAT_LAYER, behind all channels written into it so far
+//    -> Inception-style branches, e.g. 1x1 (new map), 1x1 reduce (new map),
+//       3x3 reading the reduce output and concatenating to the 1x1's map
+void addConcatLayer(network_t *net, layer_t layer, int concat_channels,
+                    bool update_memory_address = true,
+                    pooltype_t pool_type = POOL_NONE, int groups = 1,
+                    int bypass_layer = -1, int input_layer = -1,
+                    int concat_layer = -1);
+
+// ===========================================
+// = Plan Activation Memory of given Network =
+// ===========================================
+// Assigns DRAM addresses to all feature maps (tensors) of the network:
+// tensors whose lifetimes [first_layer, last_layer] do not overlap may share
+// memory. Greedy placement by decreasing size at the lowest free address,
+// aligned to net->mem_alignment Bytes (planTensorAddresses(), netdesc.hpp).
+// The input image stays at address 0, the output of a global pooling layer
+// is not stored.
+// Updates all layers' mem_addr_input / _output / _bypass and total_pixel_mem.
+void planActivationMemory(network_t *net);
 
 // =================================
 // = Load Weights from Binary File =
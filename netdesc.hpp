@@ -0,0 +1,446 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  netdesc.hpp
+//
+//  Constexpr Network Description: <layer_desc_t> table (network.hpp) and the
+//  compile-time derivation of Size Limits, Memory Addresses and Trip Counts.
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef NETDESC_HPP_5B2E9C71
+#define NETDESC_HPP_5B2E9C71
+
+// =================================
+// = Network-Independent Constants =
+// =================================
+const int NET_NAME_MAX_LEN = 6;            // max length of layer names
+const int MEMORY_ALIGNMENT = 64;  // default alignment of feature maps (Bytes)
+// floats needed to hold one layer_t (for conversion layer_t <-> float array):
+const int NUM_FLOATS_PER_LAYER = 16;
+// bits of memaddr_t (must fit into float), limits all DRAM addresses
+const int MEMADDR_BITS = 23;
+
+// ==========================
+// = Compile-Time Languages =
+// ==========================
+// The synthesized path (fpga_top.cpp and its headers) stays plain C++98 for
+// the Vivado HLS front-end: it only sees the constants in network.hpp.
+// Host builds (C++11) also see the layer table NET_LAYERS, and with C++14
+// check all constants of network.hpp against it (static_assert).
+#if !defined(__SYNTHESIS__) && __cplusplus >= 201103L
+#define NET_DESC_TABLE 1
+#define NET_CONSTEXPR constexpr
+#else
+#define NET_DESC_TABLE 0
+#define NET_CONSTEXPR
+#endif
+#if NET_DESC_TABLE && __cplusplus >= 201402L
+#define NET_DESC_CHECKS 1
+#define NET_CONSTEXPR14 constexpr
+#else
+#define NET_DESC_CHECKS 0
+#define NET_CONSTEXPR14
+#endif
+
+typedef enum {
+  LAYER_CONV,
+  LAYER_NONE  // not really used...
+  // LAYER_RELU,  // implicit after LAYER_CONV
+  // LAYER_DATA,  // implicit before first and after last layer
+  // LAYER_POOL,  // not supported, use all-convolutional networks
+} layertype_t;
+
+typedef enum {
+  POOL_NONE,
+  POOL_GLOBAL,
+  POOL_2x2S2,  // max pooling, fused into output writeback
+  POOL_3x3S2   // max pooling, fused into output writeback
+} pooltype_t;
+
+// ==================================
+// = Output Dimension after Pooling =
+// ==================================
+// Max Pooling Windows are clipped at right / bottom border (as in Caffe)
+inline NET_CONSTEXPR int pooled_dimension(int dim, pooltype_t pool) {
+  return (pool == POOL_2x2S2)    ? (dim - 2 + 1) / 2 + 1
+         : (pool == POOL_3x3S2)  ? (dim - 3 + 1) / 2 + 1
+         : (pool == POOL_GLOBAL) ? 1
+                                 : dim;
+}
+
+// ===================
+// = Struct TENSOR_T =
+// ===================
+// Feature Map in DRAM, with Lifetime (used for Activation Memory Planning)
+struct tensor_t {
+  int size;         // number of floats (0 = not stored in DRAM)
+  int first_layer;  // layer that writes the tensor (-1 = network input)
+  int last_layer;   // last layer that reads the tensor (as input or bypass)
+  int mem_addr;     // planned address within data section (floats)
+};
+
+// ==================================
+// = Plan Addresses of Feature Maps =
+// ==================================
+// Core of planActivationMemory() (netconfig.hpp), shared with the
+// compile-time plan of NET_LAYERS: tensors whose lifetimes do not overlap
+// may share memory. Greedy placement by decreasing size (stable) at the
+// lowest free address aligned to ALIGN floats, tensors[0] (input image)
+// pinned to address 0. SCRATCH: 2 * NUM_TENSORS ints.
+inline NET_CONSTEXPR int tensorLiveUntil(const tensor_t &t, int num_layers) {
+  // tensors that are never read stay alive until the end
+  return (t.last_layer > t.first_layer) ? t.last_layer : num_layers;
+}
+
+inline NET_CONSTEXPR14 void planTensorAddresses(tensor_t *tensors,
+                                               int num_tensors, int num_layers,
+                                               int align, int *scratch) {
+  int *order = scratch;                    // placement order
+  int *conflicts = scratch + num_tensors;  // placed + overlapping lifetime
+
+  // Placement Order: input image first (pinned), then by decreasing size
+  int num_order = 0;
+  for (int t = 1; t < num_tensors; t++) {
+    if (tensors[t].size <= 0) continue;
+    int i = num_order++;
+    for (; i > 0 && tensors[order[i - 1]].size < tensors[t].size; i--)
+      order[i] = order[i - 1];
+    order[i] = t;
+  }
+  tensors[0].mem_addr = 0;
+
+  // Place each Tensor at lowest aligned Address that does not collide with
+  // any already placed Tensor (input image + order[0..i-1]) with
+  // overlapping Lifetime
+  for (int i = 0; i < num_order; i++) {
+    const int t = order[i];
+    const int t_until = tensorLiveUntil(tensors[t], num_layers);
+    int num_conflicts = 0;
+    for (int j = -1; j < i; j++) {
+      int p = (j < 0) ? 0 : order[j];
+      if (tensors[p].first_layer <= t_until &&
+          tensors[t].first_layer <= tensorLiveUntil(tensors[p], num_layers)) {
+        // insert sorted by address
+        int k = num_conflicts++;
+        for (; k > 0 && tensors[conflicts[k - 1]].mem_addr >
+                            tensors[p].mem_addr;
+             k--)
+          conflicts[k] = conflicts[k - 1];
+        conflicts[k] = p;
+      }
+    }
+    int addr = 0;
+    for (int j = 0; j < num_conflicts; j++) {
+      const tensor_t &c = tensors[conflicts[j]];
+      if (c.mem_addr >= addr + tensors[t].size) break;  // fits into gap
+      int c_end = (c.mem_addr + c.size + align - 1) / align * align;
+      addr = (c_end > addr) ? c_end : addr;
+    }
+    tensors[t].mem_addr = addr;
+  }
+}
+
+// =======================
+// = Struct LAYER_DESC_T =
+// =======================
+// One row of the constexpr layer table NET_LAYERS in network.hpp, same
+// attributes as addLayer() / addConcatLayer() (netconfig.hpp):
+// EXPAND: output concatenated from 2 layers (2 x CO channels per pixel)
+// UPDATE_MEM: false = same input + output map as last layer (behind its
+//    channels), CONCAT: channels per output pixel (0 = from EXPAND)
+// INPUT_LAYER / CONCAT_LAYER: read output map of / concatenate to output
+//    map of this layer instead of the last layer (-1 = last layer)
+// Rows are brace-initialized through the constructor (GROUPS, BYPASS_LAYER,
+// CONCAT, INPUT_LAYER and CONCAT_LAYER optional)
+struct layer_desc_t {
+  const char *name;
+  layertype_t type;
+  int width;  // input dimensions
+  int height;
+  int channels_in;
+  int channels_out;
+  int kernel;
+  int pad;
+  int stride;
+  bool expand;
+  bool update_mem;
+  pooltype_t pool;
+  int groups;
+  int bypass_layer;
+  int concat;
+  int input_layer;
+  int concat_layer;
+  NET_CONSTEXPR layer_desc_t(const char *n, layertype_t t, int w, int h,
+                             int ci, int co, int k, int p, int s, bool exp,
+                             bool upd, pooltype_t pool, int groups = 1,
+                             int bypass_layer = -1, int concat = 0,
+                             int input_layer = -1, int concat_layer = -1)
+      : name(n),
+        type(t),
+        width(w),
+        height(h),
+        channels_in(ci),
+        channels_out(co),
+        kernel(k),
+        pad(p),
+        stride(s),
+        expand(exp),
+        update_mem(upd),
+        pool(pool),
+        groups(groups),
+        bypass_layer(bypass_layer),
+        concat(concat),
+        input_layer(input_layer),
+        concat_layer(concat_layer) {}
+};
+
+#if NET_DESC_TABLE
+// ============================
+// = Per-Layer Derived Values =
+// ============================
+constexpr int descNumWeights(const layer_desc_t &l) {  // conv + bias
+  return (l.channels_out / l.groups) * l.channels_in * l.kernel * l.kernel +
+         l.channels_out;
+}
+constexpr int descWidthOut(const layer_desc_t &l) {  // before pooling
+  return (l.width + 2 * l.pad - l.kernel) / l.stride + 1;
+}
+constexpr int descHeightOut(const layer_desc_t &l) {
+  return (l.height + 2 * l.pad - l.kernel) / l.stride + 1;
+}
+constexpr int descConcatChannels(const layer_desc_t &l) {
+  return (l.concat > 0) ? l.concat
+                        : (l.expand ? 2 * l.channels_out : l.channels_out);
+}
+constexpr bool descMaxPool(const layer_desc_t &l) {
+  return l.pool == POOL_2x2S2 || l.pool == POOL_3x3S2;
+}
+// floats stored in DRAM (Global Pooling: only the final result)
+constexpr int descOutputSize(const layer_desc_t &l) {
+  return (l.pool == POOL_GLOBAL)
+             ? 0
+             : (descMaxPool(l) ? pooled_dimension(descWidthOut(l), l.pool) *
+                                     pooled_dimension(descHeightOut(l), l.pool)
+                               : descWidthOut(l) * descHeightOut(l)) *
+                   descConcatChannels(l);
+}
+// Layer can run on fpga_top (processLayer<KERNEL, STRIDE, PAD> variants,
+// checkNetworkLimits())
+constexpr bool descSupported(const layer_desc_t &l) {
+  return l.type == LAYER_CONV && (l.kernel == 1 || l.kernel == 3) &&
+         (l.stride == 1 || l.stride == 2) && l.pad == (l.kernel == 3) &&
+         l.groups > 0 && l.channels_in % l.groups == 0 &&
+         l.channels_out % l.groups == 0 &&
+         !(l.bypass_layer >= 0 && descMaxPool(l));
+}
+
+// ===============================
+// = Network-Wide Derived Values =
+// ===============================
+// MIN / MAX / SUM / rounded AVG of one attribute over all layers
+typedef int (*descattr_t)(const layer_desc_t &);
+constexpr int descMax(int a, int b) { return (a > b) ? a : b; }
+constexpr int attrDimension(const layer_desc_t &l) {
+  return (l.width > l.height) ? l.width : l.height;
+}
+constexpr int attrChannelsIn(const layer_desc_t &l) { return l.channels_in; }
+constexpr int attrChannelsOut(const layer_desc_t &l) { return l.channels_out; }
+constexpr int attrChannels(const layer_desc_t &l) {  // CI, CO, out pixel
+  return descMax(descMax(l.channels_in, l.channels_out),
+                 descConcatChannels(l));
+}
+constexpr int attrInputSize(const layer_desc_t &l) {
+  return l.width * l.height * l.channels_in;
+}
+constexpr int attrOutputPixels(const layer_desc_t &l) {  // all, unpooled
+  return descWidthOut(l) * descHeightOut(l) * l.channels_out;
+}
+constexpr int attrPoolCacheSize(const layer_desc_t &l) {  // 2 pooled lines
+  return descMaxPool(l) ? 2 * pooled_dimension(descWidthOut(l), l.pool) *
+                              l.channels_out
+                        : 1;
+}
+
+#endif /* NET_DESC_TABLE */
+
+#if NET_DESC_CHECKS
+template <int N>
+constexpr int netMax(const layer_desc_t (&net)[N], descattr_t attr) {
+  int m = attr(net[0]);
+  for (int i = 1; i < N; i++) m = (attr(net[i]) > m) ? attr(net[i]) : m;
+  return m;
+}
+template <int N>
+constexpr int netMin(const layer_desc_t (&net)[N], descattr_t attr) {
+  int m = attr(net[0]);
+  for (int i = 1; i < N; i++) m = (attr(net[i]) < m) ? attr(net[i]) : m;
+  return m;
+}
+template <int N>
+constexpr int netSum(const layer_desc_t (&net)[N], descattr_t attr) {
+  int s = 0;
+  for (int i = 0; i < N; i++) s += attr(net[i]);
+  return s;
+}
+template <int N>
+constexpr int netAvg(const layer_desc_t (&net)[N], descattr_t attr) {
+  return (netSum(net, attr) + N / 2) / N;
+}
+// MAX_IMAGE_CACHE_SIZE for NUM_CACHE_LINES image cache lines
+template <int N>
+constexpr int netMaxImageCacheSize(const layer_desc_t (&net)[N],
+                                   int num_cache_lines) {
+  int m = 0;
+  for (int i = 0; i < N; i++) {
+    int size = num_cache_lines * net[i].width * net[i].channels_in;
+    m = (size > m) ? size : m;
+  }
+  return m;
+}
+
+// ========================
+// = Compile-Time Network =
+// ========================
+// Same tensor bookkeeping as addConcatLayer() + planActivationMemory()
+// for the whole table: memory addresses of all layers (floats, input and
+// output relative to the data section, weights to the weights section)
+template <int N>
+struct net_plan_t {
+  bool valid;  // all layers supported, concatenations + bypasses consistent
+  tensor_t tensors[N + 1];
+  int num_tensors;
+  int input_tensor[N];
+  int output_tensor[N];
+  int bypass_tensor[N];
+  int out_channel_offset[N];
+  int mem_addr_weights[N];
+  int total_weights;
+  int total_pixel_mem;  // incl. final result (2 * CH_OUT + 1 for Top-K)
+  constexpr int memAddrInput(int l) const {
+    return tensors[input_tensor[l]].mem_addr;
+  }
+  constexpr int memAddrOutput(int l) const {
+    return tensors[output_tensor[l]].mem_addr;
+  }
+  constexpr int memAddrBypass(int l) const {
+    return (bypass_tensor[l] >= 0) ? tensors[bypass_tensor[l]].mem_addr : 0;
+  }
+};
+
+template <int N>
+constexpr net_plan_t<N> netPlan(const layer_desc_t (&net)[N],
+                                int mem_alignment) {
+  net_plan_t<N> p{};
+  p.valid = true;
+  tensor_t image = {attrInputSize(net[0]), -1, -1, 0};
+  p.tensors[0] = image;
+  p.num_tensors = 1;
+
+  for (int l = 0; l < N; l++) {
+    const layer_desc_t &layer = net[l];
+    p.valid = p.valid && descSupported(layer);
+    bool new_output = layer.update_mem || l == 0;
+    int input_layer = (layer.input_layer < l) ? layer.input_layer : -1;
+    int target = (layer.concat_layer >= 0 && layer.concat_layer < l)
+                     ? layer.concat_layer
+                     : l - 1;
+    p.valid = p.valid && layer.input_layer < l && layer.concat_layer < l;
+    if (l == 0)
+      p.input_tensor[l] = 0;
+    else if (input_layer >= 0)
+      p.input_tensor[l] = p.output_tensor[input_layer];
+    else
+      p.input_tensor[l] =
+          new_output ? p.output_tensor[l - 1] : p.input_tensor[l - 1];
+    p.out_channel_offset[l] = 0;
+    if (new_output) {
+      tensor_t output = {descOutputSize(layer), l, l, 0};
+      p.output_tensor[l] = p.num_tensors;
+      p.tensors[p.num_tensors++] = output;
+    } else {
+      // behind all channels already written into the concatenated map
+      p.output_tensor[l] = p.output_tensor[target];
+      for (int w = 0; w < l; w++) {
+        int end = p.out_channel_offset[w] + net[w].channels_out;
+        if (p.output_tensor[w] == p.output_tensor[l])
+          p.out_channel_offset[l] = descMax(p.out_channel_offset[l], end);
+      }
+      p.valid = p.valid &&
+                descConcatChannels(layer) == descConcatChannels(net[target]) &&
+                descOutputSize(layer) == p.tensors[p.output_tensor[l]].size;
+    }
+    p.valid = p.valid && p.out_channel_offset[l] + layer.channels_out <=
+                             descConcatChannels(layer);
+    p.valid = p.valid && p.input_tensor[l] != p.output_tensor[l];
+    // input map: W x H pixels of exactly CH_IN channels
+    int input = p.input_tensor[l];
+    int input_stride =
+        (input == 0) ? net[0].channels_in
+                     : descConcatChannels(net[p.tensors[input].first_layer]);
+    p.valid = p.valid && (l == 0 || (p.tensors[input].size ==
+                                         attrInputSize(layer) &&
+                                     input_stride == layer.channels_in));
+    p.tensors[p.input_tensor[l]].last_layer = l;
+
+    p.bypass_tensor[l] = -1;
+    if (layer.bypass_layer >= 0 && layer.bypass_layer < l) {
+      // same shape + pixel layout as the output map (before global pooling)
+      int bypass = p.input_tensor[layer.bypass_layer];
+      int writer = p.tensors[bypass].first_layer;
+      int bypass_stride = (bypass == 0) ? net[0].channels_in
+                                        : descConcatChannels(net[writer]);
+      p.valid = p.valid &&
+                p.tensors[bypass].size == descWidthOut(layer) *
+                                              descHeightOut(layer) *
+                                              descConcatChannels(layer) &&
+                bypass_stride == descConcatChannels(layer);
+      p.bypass_tensor[l] = bypass;
+      p.tensors[bypass].last_layer = l;
+    } else if (layer.bypass_layer >= 0) {
+      p.valid = false;
+    }
+
+    // Weights are stored sequentially, in order of layers (not aligned)
+    p.mem_addr_weights[l] = p.total_weights;
+    p.total_weights += descNumWeights(layer);
+  }
+
+  int align = (mem_alignment / (int)sizeof(float) > 1)
+                  ? mem_alignment / (int)sizeof(float)
+                  : 1;  // floats
+  int scratch[2 * (N + 1)] = {};
+  planTensorAddresses(p.tensors, p.num_tensors, N, align, scratch);
+
+  int total = 2 * net[N - 1].channels_out + 1;
+  for (int t = 0; t < p.num_tensors; t++) {
+    int end = p.tensors[t].mem_addr + p.tensors[t].size;
+    total = (end > total) ? end : total;
+  }
+  p.total_pixel_mem = total;
+  return p;
+}
+
+// =====================
+// = Shared DRAM Depth =
+// =====================
+// Floats allocated by allocate_FPGA_memory() (cpu_top.cpp): layer config +
+// weights + NUM_SLOTS x (aligned data section + COUNTERS per layer)
+template <int N>
+constexpr int netDramDepth(const layer_desc_t (&net)[N],
+                           const net_plan_t<N> &plan, int mem_alignment,
+                           int num_slots, int counters_per_layer) {
+  int align = (mem_alignment / (int)sizeof(float) > 1)
+                  ? mem_alignment / (int)sizeof(float)
+                  : 1;  // floats
+  int data_slot = (plan.total_pixel_mem + align - 1) / align * align;
+  return N * NUM_FLOATS_PER_LAYER + plan.total_weights +
+         num_slots * (data_slot + N * counters_per_layer);
+}
+
+#endif /* NET_DESC_CHECKS */
+
+#endif /* end of include guard: NETDESC_HPP_5B2E9C71 */
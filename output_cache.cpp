@@ -17,7 +17,7 @@
 // ================
 #ifdef EBUG
 OutputCache::OutputCache(const char *name)
-    : _name(name)
+    : _name(name) {}
 #else
 OutputCache::OutputCache(const char *name)
 {
@@ -0,0 +1,87 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  perf_counters.cpp
+//
+//  Performance Counter Block for FPGA (per-layer cycles, iterations, DRAM I/O)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "perf_counters.hpp"
+
+// ========================
+// = Performance Counters =
+// ========================
+// PE.preloadPixels(): 9 pixels
+const int PERF_PRELOAD_ITERATIONS = 9;
+
+PerfCounters::PerfCounters() {
+#pragma HLS ARRAY_PARTITION variable = counters complete dim = 0
+  cycle_timestamp = NULL;
+  layer_start = 0;
+  reset();
+}
+
+void PerfCounters::setCycleTimestamp(volatile unsigned int *cycle_timestamp) {
+  this->cycle_timestamp = cycle_timestamp;
+}
+
+counter_t PerfCounters::timestamp() {
+#pragma HLS inline
+#ifndef __SYNTHESIS__
+  // C-Sim without RTL counter: one cycle per counted loop iteration
+  if (!cycle_timestamp) return counters[PERF_ITERATIONS];
+#endif
+  return *cycle_timestamp;
+}
+
+void PerfCounters::startLayer() {
+  reset();
+  layer_start = timestamp();
+}
+
+void PerfCounters::endLayer() {
+  // (unsigned difference: correct across one wrap-around of the counter)
+  counters[PERF_CYCLES] = timestamp() - layer_start;
+}
+
+void PerfCounters::countStall(counter_t start) {
+#pragma HLS inline
+  counters[PERF_STALL_CYCLES] += timestamp() - start;
+}
+
+void PerfCounters::reset() {
+L_PerfCounters_reset:
+  for (int i = 0; i < NUM_PERF_COUNTERS; i++) {
+#pragma HLS unroll
+    counters[i] = 0;
+  }
+}
+
+void PerfCounters::countDRAMRead() {
+#pragma HLS inline
+  counters[PERF_ITERATIONS]++;
+  counters[PERF_WORDS_READ]++;
+}
+
+void PerfCounters::countDRAMWrite() {
+#pragma HLS inline
+  counters[PERF_ITERATIONS]++;
+  counters[PERF_WORDS_WRITTEN]++;
+}
+
+void PerfCounters::countPEChannel(channel_t ch_out_per_group) {
+#pragma HLS inline
+  counters[PERF_ITERATIONS] += PERF_PRELOAD_ITERATIONS + (int)ch_out_per_group;
+  counters[PERF_MAC_ITERATIONS] += (int)ch_out_per_group;
+}
+
+void PerfCounters::countPostprocess(channel_t ch_out) {
+#pragma HLS inline
+  counters[PERF_ITERATIONS] += (int)ch_out;
+}
+
+counter_t PerfCounters::get(perfcounter_t c) { return counters[c]; }
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  perf_counters.hpp
+//
+//  Performance Counter Block for FPGA (per-layer cycles, iterations, DRAM I/O)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef PERF_COUNTERS_HPP_3D8A61F2
+#define PERF_COUNTERS_HPP_3D8A61F2
+
+// Data Types for FPGA Implementation
+#include "fpga_top.hpp"
+
+// ========================
+// = Performance Counters =
+// ========================
+// Counted per layer by fpga_top() + MemoryController, written to the stats
+// region in shared DRAM after each layer (NUM_PERF_COUNTERS uint32 in
+// floats per layer, in this order, see print_FPGA_perf_counters()).
+// Cycles: differences of the free-running cycle timestamp (RTL counter on
+// the ap_none input of fpga_top), sampled at layer start / end and around
+// each DRAM read (loadNextChannel / loadNextWeight: stall cycles).
+// C-Sim without timestamp: one cycle per counted loop iteration.
+// Iterations: DRAM reads + writes (one word each), PE preload + L_CH_OUT,
+// L_POSTPROCESS.
+typedef enum {
+  PERF_ITERATIONS,      // all loop iterations of the layer
+  PERF_MAC_ITERATIONS,  // L_CH_OUT iterations (PEs active)
+  PERF_WORDS_READ,      // words read from DRAM (weights, pixels, bypass)
+  PERF_WORDS_WRITTEN,   // words written to DRAM (output pixels)
+  PERF_CYCLES,          // clock cycles from layer start to end
+  PERF_STALL_CYCLES     // clock cycles in loadNextChannel / loadNextWeight
+} perfcounter_t;
+const int NUM_PERF_COUNTERS = 6;
+
+typedef unsigned int counter_t;
+
+class PerfCounters {
+ public:
+  PerfCounters();
+  // cycle_timestamp: free-running cycle counter (NULL: C-Sim model)
+  void setCycleTimestamp(volatile unsigned int *cycle_timestamp);
+  counter_t timestamp();
+  void startLayer();  // reset counters, sample layer start
+  void endLayer();    // sample layer end -> PERF_CYCLES
+  void countStall(counter_t start);  // cycles since start -> stalls
+  void reset();
+  void countDRAMRead();
+  void countDRAMWrite();
+  void countPEChannel(channel_t ch_out_per_group);
+  void countPostprocess(channel_t ch_out);
+  counter_t get(perfcounter_t c);
+
+ private:
+  counter_t counters[NUM_PERF_COUNTERS];
+  volatile unsigned int *cycle_timestamp;
+  counter_t layer_start;
+};
+
+#endif /* end of include guard: PERF_COUNTERS_HPP_3D8A61F2 */
@@ -0,0 +1,157 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  perf_model.cpp
+//
+//  Analytical Performance Model (cycles, MACs, DRAM traffic per layer)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "perf_model.hpp"
+#include <algorithm>
+#include <cmath>
+
+// ===================================
+// = Architecture Parameters (Model) =
+// ===================================
+perf_arch_t defaultPerfArch() {
+  perf_arch_t arch;
+  arch.clock_mhz = 200;
+  arch.n_pe = N_PE;
+  arch.taps_per_pe = 9;
+  arch.chout_ii = 1;
+  arch.chout_latency = 10;
+  arch.preload_cycles = 9;
+  arch.postprocess_ii = 1;
+  arch.bus_bytes = sizeof(data_t);
+  arch.img_cache_lines = NUM_IMG_CACHE_LINES;
+  return arch;
+}
+
+// ============================
+// = Performance of one Layer =
+// ============================
+layer_perf_t estimateLayerPerformance(layer_t *layer, const perf_arch_t &arch) {
+  double width = layer->width, height = layer->height;
+  double ch_in = layer->channels_in, ch_out = layer->channels_out;
+  double ch_out_per_group = ch_out / (int)layer->groups;
+  double taps = (int)layer->kernel * (int)layer->kernel;
+  double width_out = (int)layer->width / (int)layer->stride;
+  double height_out = (int)layer->height / (int)layer->stride;
+  double num_weights = ch_in * ch_out_per_group * taps + ch_out;
+  double bus = arch.bus_bytes;
+
+  // DRAM Traffic (feature maps written after pooling, global pool: result)
+  double output_pixels = width_out * height_out;
+  if (layer->pool == POOL_2x2S2 || layer->pool == POOL_3x3S2)
+    output_pixels = pooled_dimension(width_out, layer->pool) *
+                    pooled_dimension(height_out, layer->pool);
+  if (layer->pool == POOL_GLOBAL) output_pixels = 1;
+  double weight_bytes = num_weights * sizeof(data_t);
+  double input_bytes = width * height * ch_in * sizeof(data_t);
+  double bypass_bytes =
+      layer->has_bypass ? width_out * height_out * ch_out * sizeof(data_t) : 0;
+
+  layer_perf_t perf;
+  perf.macs = width_out * height_out * ch_in * ch_out_per_group * taps;
+  perf.dram_read_bytes = weight_bytes + input_bytes + bypass_bytes;
+  perf.dram_write_bytes = output_pixels * ch_out * sizeof(data_t);
+  double dram_bytes = perf.dram_read_bytes + perf.dram_write_bytes;
+  perf.intensity = 2 * perf.macs / dram_bytes;
+
+  // Sequential Loop Nest (as in fpga_top): load weights, then per input
+  // pixel: preload into ICache; per output pixel: per input channel preload
+  // 3x3 window + all output channels of its group in the PE pipeline,
+  // postprocess all output channels, write back
+  double pe_cycles_per_ci =
+      arch.preload_cycles +
+      std::ceil(ch_out_per_group / arch.n_pe) * arch.chout_ii +
+      arch.chout_latency;
+  double cycles_per_output_pixel =
+      ch_in * pe_cycles_per_ci + ch_out * arch.postprocess_ii;
+  perf.cycles = weight_bytes / bus + input_bytes / bus + bypass_bytes / bus +
+                width_out * height_out * cycles_per_output_pixel +
+                perf.dram_write_bytes / bus;
+
+  // Roofline: peak compute (all PE multipliers busy) vs. peak bandwidth
+  double peak_ops_per_cycle = 2.0 * arch.n_pe * arch.taps_per_pe;
+  perf.roofline_cycles =
+      std::max(2 * perf.macs / peak_ops_per_cycle, dram_bytes / bus);
+  perf.memory_bound = (perf.intensity < peak_ops_per_cycle / bus);
+  perf.image_cache_words = arch.img_cache_lines * width * ch_in;
+  return perf;
+}
+
+// ===================================
+// = Print Performance of all Layers =
+// ===================================
+void printPerformanceTable(network_t *net, const perf_arch_t &arch,
+                           FILE *out) {
+  fprintf(out,
+          "Performance Model (%d PE x %d MAC, %.0f MHz, %d B/cycle DRAM):\n",
+          arch.n_pe, arch.taps_per_pe, arch.clock_mhz, arch.bus_bytes);
+  fprintf(out, "%6s: %9s %9s %9s %7s %11s %9s %6s %6s %8s\n", "layer",
+          "MMACs", "rd [kB]", "wr [kB]", "ops/B", "cycles", "ms", "bound",
+          "eff.", "ICache");
+  double total_macs = 0, total_bytes = 0, total_cycles = 0;
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    layer_perf_t perf = estimateLayerPerformance(layer, arch);
+    fprintf(out,
+            "%6s: %9.2f %9.1f %9.1f %7.2f %11.0f %9.3f %6s %5.1f%% %7.0f%s\n",
+            layer->name, perf.macs / 1e6, perf.dram_read_bytes / 1024,
+            perf.dram_write_bytes / 1024, perf.intensity, perf.cycles,
+            perf.cycles / (arch.clock_mhz * 1e3),
+            perf.memory_bound ? "memory" : "comp.",
+            100 * perf.roofline_cycles / perf.cycles,
+            perf.image_cache_words,
+            (perf.image_cache_words > MAX_IMAGE_CACHE_SIZE) ? "!" : "");
+    total_macs += perf.macs;
+    total_bytes += perf.dram_read_bytes + perf.dram_write_bytes;
+    total_cycles += perf.cycles;
+  }
+  double total_ms = total_cycles / (arch.clock_mhz * 1e3);
+  fprintf(out, "%6s: %9.2f %19.1f %7.2f %11.0f %9.3f\n", "total",
+          total_macs / 1e6, total_bytes / 1024, 2 * total_macs / total_bytes,
+          total_cycles, total_ms);
+  fprintf(out, "        -> %.2f GOPS, %.2f images/s\n",
+          2 * total_macs / (total_ms * 1e6), 1000 / total_ms);
+}
+
+void printPerformanceJSON(network_t *net, const perf_arch_t &arch,
+                          FILE *out) {
+  fprintf(out, "{\n  \"arch\": {\"clock_mhz\": %g, \"n_pe\": %d, "
+               "\"taps_per_pe\": %d, \"chout_ii\": %d, \"chout_latency\": %d, "
+               "\"preload_cycles\": %d, \"postprocess_ii\": %d, "
+               "\"bus_bytes\": %d, \"img_cache_lines\": %d},\n",
+          arch.clock_mhz, arch.n_pe, arch.taps_per_pe, arch.chout_ii,
+          arch.chout_latency, arch.preload_cycles, arch.postprocess_ii,
+          arch.bus_bytes, arch.img_cache_lines);
+  fprintf(out, "  \"layers\": [\n");
+  double total_macs = 0, total_bytes = 0, total_cycles = 0;
+  for (int i = 0; i < net->num_layers; i++) {
+    layer_t *layer = &net->layers[i];
+    layer_perf_t perf = estimateLayerPerformance(layer, arch);
+    fprintf(out,
+            "    {\"name\": \"%s\", \"macs\": %.0f, \"dram_read_bytes\": %.0f, "
+            "\"dram_write_bytes\": %.0f, \"intensity\": %.4f, "
+            "\"cycles\": %.0f, \"roofline_cycles\": %.0f, "
+            "\"bound\": \"%s\", \"image_cache_words\": %.0f}%s\n",
+            layer->name, perf.macs, perf.dram_read_bytes,
+            perf.dram_write_bytes, perf.intensity, perf.cycles,
+            perf.roofline_cycles, perf.memory_bound ? "memory" : "compute",
+            perf.image_cache_words, (i < net->num_layers - 1) ? "," : "");
+    total_macs += perf.macs;
+    total_bytes += perf.dram_read_bytes + perf.dram_write_bytes;
+    total_cycles += perf.cycles;
+  }
+  double total_ms = total_cycles / (arch.clock_mhz * 1e3);
+  fprintf(out, "  ],\n  \"total\": {\"macs\": %.0f, \"dram_bytes\": %.0f, "
+               "\"cycles\": %.0f, \"ms\": %.4f, \"gops\": %.4f, "
+               "\"images_per_s\": %.4f}\n}\n",
+          total_macs, total_bytes, total_cycles, total_ms,
+          2 * total_macs / (total_ms * 1e6), 1000 / total_ms);
+}
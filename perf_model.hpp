@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  perf_model.hpp
+//
+//  Analytical Performance Model (cycles, MACs, DRAM traffic per layer)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef PERF_MODEL_HPP_E61B0C4D
+#define PERF_MODEL_HPP_E61B0C4D
+
+#include <cstdio>
+#include "fpga_top.hpp"
+
+// ===================================
+// = Architecture Parameters (Model) =
+// ===================================
+// Mirrors the loop structure of fpga_top() and the pipeline pragmas of the
+// modules, change to evaluate architecture variants before synthesis
+struct perf_arch_t {
+  double clock_mhz;     // accelerator clock
+  int n_pe;             // processing elements (output channels per cycle)
+  int taps_per_pe;      // multipliers per PE (macc2d: 3x3 window)
+  int chout_ii;         // initiation interval of L_CH_OUT (PE)
+  int chout_latency;    // pipeline fill of L_CH_OUT per input channel
+  int preload_cycles;   // preloadPixels() per input channel (9 px, II=2)
+  int postprocess_ii;   // initiation interval of L_POSTPROCESS
+  int bus_bytes;        // DRAM bus width (Bytes per cycle, m_axi memorybus)
+  int img_cache_lines;  // input rows in ImageCache (NUM_IMG_CACHE_LINES)
+};
+perf_arch_t defaultPerfArch();
+
+// ============================
+// = Performance of one Layer =
+// ============================
+struct layer_perf_t {
+  double macs;              // useful multiply-accumulates
+  double dram_read_bytes;   // weights + biases, input map, bypass map
+  double dram_write_bytes;  // output map (after pooling) or global pool
+  double intensity;         // operations (2 per MAC) per DRAM byte
+  double cycles;            // estimate for the sequential loop nest
+  double roofline_cycles;   // lower bound: peak compute or peak bandwidth
+  bool memory_bound;        // intensity below ridge point of the roofline
+  double image_cache_words; // ImageCache size needed (! > MAX_IMAGE_CACHE)
+};
+layer_perf_t estimateLayerPerformance(layer_t *layer, const perf_arch_t &arch);
+
+// ===================================
+// = Print Performance of all Layers =
+// ===================================
+// Table: one line per layer + total (ms, GOPS, images/s at arch clock)
+void printPerformanceTable(network_t *net, const perf_arch_t &arch,
+                           FILE *out);
+// Same content as JSON object {"arch": .., "layers": [..], "total": ..}
+void printPerformanceJSON(network_t *net, const perf_arch_t &arch,
+                          FILE *out);
+
+#endif /* end of include guard: PERF_MODEL_HPP_E61B0C4D */
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  pooling_cache.cpp
+//
+//  Pooling Cache Module for FPGA (fused 2x2/S2 and 3x3/S2 Max Pooling)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "pooling_cache.hpp"
+
+// =================
+// = Pooling Cache =
+// =================
+PoolingCache::PoolingCache(){};
+
+void PoolingCache::setLayerConfig(layer_t &layer) {
+  pool_kernel = (layer.pool == POOL_3x3S2) ? 3 : 2;
+  width_in = (layer.stride == 2) ? (layer.width / 2) : (layer.width / 1);
+  height_in = (layer.stride == 2) ? (layer.height / 2) : (layer.height / 1);
+  width_out = pooled_dimension(width_in, layer.pool);
+  height_out = pooled_dimension(height_in, layer.pool);
+  ch_out = layer.channels_out;
+  // (only used by max pooling layers: others may exceed MAX_POOL_CACHE_SIZE)
+  bool max_pool = (layer.pool == POOL_2x2S2 || layer.pool == POOL_3x3S2);
+  line_width = max_pool ? (int)(width_out * ch_out) : 0;
+
+  LOG("PoolingCache: setLayerConfig\n");
+  LOG(" - pool_kernel     = %d\n", (int)pool_kernel);
+  LOG(" - width_in        = %d\n", (int)width_in);
+  LOG(" - height_in       = %d\n", (int)height_in);
+  LOG(" - width_out       = %d\n", (int)width_out);
+  LOG(" - height_out      = %d\n", (int)height_out);
+  LOG(" - ch_out          = %d\n", (int)ch_out);
+  LOG(" - line_width      = %d\n", (int)line_width);
+}
+
+void PoolingCache::poolPixel(coordinate_t y, coordinate_t x,
+                             OutputCache *OCache, MemoryController *DRAM) {
+  LOG("PoolingCache: poolPixel (y: %2d, x: %2d)\n", (int)y, (int)x);
+  LOG_LEVEL_INCR;
+
+// Candidate Windows: start at (2*py, 2*px) with py = y/2 or y/2-1 (same for x)
+L_POOL_WINDOW_Y:
+  for (int wy = 0; wy < 2; wy++) {
+  L_POOL_WINDOW_X:
+    for (int wx = 0; wx < 2; wx++) {
+      coordinate_t py = y / 2 - wy;
+      coordinate_t px = x / 2 - wx;
+
+      // Does window (py, px) contain CONV output pixel (y, x)?
+      bool in_y = (py >= 0) & (py < height_out) & (y < 2 * py + pool_kernel);
+      bool in_x = (px >= 0) & (px < width_out) & (x < 2 * px + pool_kernel);
+      if (!(in_y & in_x)) continue;
+
+      // First pixel of window initializes, last pixel finishes the window
+      // (windows are clipped at the right / bottom border)
+      coordinate_t y_last = 2 * py + pool_kernel - 1;
+      coordinate_t x_last = 2 * px + pool_kernel - 1;
+      if (y_last >= height_in) y_last = height_in - 1;
+      if (x_last >= width_in) x_last = width_in - 1;
+      bool first = (y == 2 * py) & (x == 2 * px);
+      bool last = (y == y_last) & (x == x_last);
+
+      poolcacheaddr_t addr = (py % 2) * line_width + px * ch_out;
+      LOG("window (%2d, %2d)%s%s @PCACHE[%4d]\n", (int)py, (int)px,
+          first ? ", first" : "", last ? ", last -> write back" : "",
+          (int)addr);
+
+      if (last) DRAM->setOutputPixel(py, px);
+
+    L_POOL_CHANNELS:
+      for (channel_t co = 0; co < ch_out; co++) {
+#pragma HLS LOOP_TRIPCOUNT min=MIN_NUM_CHOUT max=MAX_NUM_CHOUT avg=AVG_NUM_CHOUT
+#pragma HLS DEPENDENCE variable=BRAM inter false
+#pragma HLS pipeline II=1
+        data_t value = OCache->getChannel(co);
+        data_t old_max = BRAM[addr + co];
+        data_t pooled = (first | (value > old_max)) ? value : old_max;
+        if (last)
+          DRAM->storeNextChannel(pooled);
+        else
+          BRAM[addr + co] = pooled;
+      }
+    }
+  }
+
+  LOG_LEVEL_DECR;
+}
@@ -0,0 +1,46 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  pooling_cache.hpp
+//
+//  Pooling Cache Module for FPGA (fused 2x2/S2 and 3x3/S2 Max Pooling)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef POOLING_CACHE_HPP_5B2E9D41
+#define POOLING_CACHE_HPP_5B2E9D41
+
+// Data Types for FPGA Implementation
+#include "fpga_top.hpp"
+
+#include "memory_controller.hpp"
+#include "output_cache.hpp"
+
+// =================
+// = Pooling Cache =
+// =================
+// Holds 2 lines of partially max-pooled output pixels. Pooling windows start
+// at every 2nd CONV output pixel, so each CONV output pixel contributes to at
+// most 2x2 windows. Finished windows are written back to DRAM directly.
+class PoolingCache {
+ public:
+  PoolingCache();
+  void setLayerConfig(layer_t &layer);
+  void poolPixel(coordinate_t y, coordinate_t x, OutputCache *OCache,
+                 MemoryController *DRAM);
+
+ private:
+  data_t BRAM[POOL_CACHE_BRAM_SIZE];
+  kernel_t pool_kernel;
+  dimension_t width_in;  // dimensions of CONV output (= pooling input)
+  dimension_t height_in;
+  dimension_t width_out;  // dimensions of pooled output
+  dimension_t height_out;
+  channel_t ch_out;
+  poolcacheaddr_t line_width;
+};
+
+#endif /* end of include guard: POOLING_CACHE_HPP_5B2E9D41 */
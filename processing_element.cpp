@@ -27,6 +27,8 @@ void ProcessingElement::setup(ImageCache *ICache, WeightsCache *WCache,
 void ProcessingElement::setLayerConfig(layer_t &layer) {
   kernel = layer.kernel;
   ch_out = layer.channels_out;
+  ch_in_per_group = layer.channels_in / layer.groups;
+  ch_out_per_group = layer.channels_out / layer.groups;
   width_in = layer.width;
   height_in = layer.height;
 
@@ -34,16 +36,31 @@ void ProcessingElement::setLayerConfig(layer_t &layer) {
     LOG("PE: setLayerConfig\n");
     LOG(" - kernel   = %d\n", (int)kernel);
     LOG(" - ch_out   = %d\n", (int)ch_out);
+    LOG(" - groups   = %d\n", (int)layer.groups);
     LOG(" - width_in = %d\n", (int)width_in);
   }
 }
 
+// Compile-time KERNEL + PAD (dispatched once per layer in fpga_top):
+// 3x3 loads the window around (y, x), zero-padded at the borders only if
+// PAD; 1x1 loads just the center pixel (buffer[4])
+template <int KERNEL, int PAD>
 void ProcessingElement::preloadPixels(coordinate_t y_center,
                                       coordinate_t x_center, channel_t ci,
                                       data_t buffer[9]) {
   LOG("PE: preloadPixels (y_center: %2d, x_center: %2d, ci: %2d)\n",
       (int)y_center, (int)x_center, (int)ci);
 
+  if (KERNEL == 1) {
+    LOG_LEVEL_INCR;
+    buffer[4] = ICache->getPixel(y_center, x_center, ci);
+    LOG_LEVEL_DECR;
+    if (LOG_DETAILS)
+      LOG(" - loaded (y: %2d, x: %2d) = %6.2f\n", (int)y_center,
+          (int)x_center, buffer[4]);
+    return;
+  }
+
 L_PE_loadPixel_Y:
   for (int k = 0; k < 3; k++) {
   L_PE_loadPixel_X:
@@ -55,7 +72,7 @@ L_PE_loadPixel_Y:
       coordinate_t y = y_center + k - 1;
       coordinate_t x = x_center + l - 1;
       data_t px;
-      bool pad = (x < 0 | y < 0 | x >= width_in | y >= height_in);
+      bool pad = PAD && (x < 0 | y < 0 | x >= width_in | y >= height_in);
       LOG_LEVEL_INCR;
       px = pad ? 0.0f : ICache->getPixel(y, x, ci);
       buffer[k * 3 + l] = px;
@@ -67,6 +84,7 @@ L_PE_loadPixel_Y:
   }
 }
 
+template <int KERNEL, int PAD>
 void ProcessingElement::processInputChannel(const coordinate_t y,
                                             const coordinate_t x,
                                             const channel_t ci) {
@@ -79,33 +97,46 @@ void ProcessingElement::processInputChannel(const coordinate_t y,
   // Setup Weights Cache (will deliver weights for CH_IN ci)
   WCache->setInputChannel(ci);
   // Preload Image Pixel Buffer (fetch pixels around (y,x,ci))
-  preloadPixels(y, x, ci, pixel_buffer);
+  preloadPixels<KERNEL, PAD>(y, x, ci, pixel_buffer);
+  // Grouped Conv: CH_IN ci only feeds output channels of its own group
+  channel_t co_offset = (ci / ch_in_per_group) * ch_out_per_group;
   // Process All Output Channels (MACC output pixels (y, x, ...))
-  processAllCHout(pixel_buffer);
+  processAllCHout<KERNEL>(pixel_buffer, co_offset);
   LOG_LEVEL_DECR;
 }
-
-void ProcessingElement::processAllCHout(const data_t pixels[9]) {
-  LOG("PE: processAllCHout\n");
+// Supported Layer Variants (see fpga_top.cpp)
+template void ProcessingElement::processInputChannel<1, 0>(
+    const coordinate_t y, const coordinate_t x, const channel_t ci);
+template void ProcessingElement::processInputChannel<3, 1>(
+    const coordinate_t y, const coordinate_t x, const channel_t ci);
+
+template <int KERNEL>
+void ProcessingElement::processAllCHout(const data_t pixels[9],
+                                        channel_t co_offset) {
+  LOG("PE: processAllCHout (co %d - %d)\n", (int)co_offset,
+      (int)(co_offset + ch_out_per_group - 1));
   LOG_LEVEL_INCR;
 
 L_CH_OUT:
-  for (channel_t co = 0; co < ch_out; co++) {
+  for (channel_t co = 0; co < ch_out_per_group; co++) {
 	data_t result, weights_local[9];
 #pragma HLS ARRAY_PARTITION variable = weights_local complete dim = 0
 
-#pragma HLS LOOP_TRIPCOUNT min=16 max=1024 avg=258
+#pragma HLS LOOP_TRIPCOUNT min=MIN_NUM_CHOUT max=MAX_NUM_CHOUT avg=AVG_NUM_CHOUT
 //#pragma HLS unroll factor=8
 #pragma HLS PIPELINE II=1 rewind
 
     LOG(" - process output channel %d\n", (int)co);
     LOG_LEVEL_INCR;
     // fetch weights
-    WCache->getNineWeights(co, weights_local);
-    // multiply-accumulate
-    macc2d(pixels, weights_local, result);
+    WCache->getNineWeights<KERNEL>(co, weights_local);
+    // multiply-accumulate (1x1: single multiplication)
+    if (KERNEL == 3)
+      macc2d(pixels, weights_local, result);
+    else
+      result = pixels[4] * weights_local[4];
     // save result to Output Buffer
-    OCache->accumulateChannel(co, result);
+    OCache->accumulateChannel(co_offset + co, result);
     LOG_LEVEL_DECR;
   };
   LOG_LEVEL_DECR;
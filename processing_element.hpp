@@ -28,18 +28,25 @@ class ProcessingElement {
   ProcessingElement();
   void setup(ImageCache *ICache, WeightsCache *WCache, OutputCache *OCache);
   void setLayerConfig(layer_t &layer);
+  // Specialized per layer variant: KERNEL 1 or 3, PAD = zero padding of
+  // the 3x3 window (instantiated: <1, 0>, <3, 1>)
+  template <int KERNEL, int PAD>
   void processInputChannel(coordinate_t y_in, coordinate_t x_in, channel_t ci);
 
  private:
+  template <int KERNEL, int PAD>
   void preloadPixels(coordinate_t y_in, coordinate_t x_in, channel_t ci,
                      data_t buffer[9]);
-  void processAllCHout(const data_t pixels[9]);
+  template <int KERNEL>
+  void processAllCHout(const data_t pixels[9], channel_t co_offset);
   void macc2d(const data_t pixels[9], const data_t weights[9], data_t& result);
   ImageCache *ICache;
   WeightsCache *WCache;
   OutputCache *OCache;
   kernel_t kernel;
   channel_t ch_out;
+  channel_t ch_in_per_group;
+  channel_t ch_out_per_group;
   dimension_t width_in;
   dimension_t height_in;
   data_t mult_result[9];
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  regression.cpp
+//
+//  Parallel Regression Runner (accuracy + latency over many prepared inputs)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "regression.hpp"
+#include <cstring>
+#include <string>
+
+// ==================
+// = Run Regression =
+// ==================
+
+int runRegression(AcceleratorRuntime &runtime, const char *list_file,
+                  FILE *out) {
+  typedef std::chrono::steady_clock clock;
+
+  // Read Image List
+  FILE *list = fopen(list_file, "r");
+  if (!list) {
+    printf("ERROR: File %s could not be opened!\n", list_file);
+    return -1;
+  }
+  std::string list_dir(list_file);
+  list_dir = list_dir.substr(0, list_dir.find_last_of('/') + 1);
+  struct image_t {
+    std::string file;
+    int label;  // -1 = unknown
+  };
+  std::vector<image_t> images;
+  char line[4096], name[4096];
+  while (fgets(line, sizeof(line), list)) {
+    int label = -1;
+    if (sscanf(line, "%4095s %d", name, &label) < 1 || name[0] == '#')
+      continue;
+    image_t img = {name, label};
+    if (name[0] != '/') img.file = list_dir + img.file;
+    images.push_back(img);
+  }
+  fclose(list);
+  printf("CPU: Regression over %d images from %s\n", (int)images.size(),
+         list_file);
+
+  // Classify: keep all Job Slots busy, collect Results in List Order
+  struct job_t {
+    int image;
+    int job;
+  };
+  std::deque<job_t> pending;
+  std::vector<data_t> input(runtime.inputSize());
+  std::vector<data_t> results(runtime.outputSize());
+  std::vector<std::pair<data_t, int> > probabilities;
+  std::vector<double> latencies;
+  int num_labeled = 0, num_top1 = 0, num_top5 = 0, num_failed = 0;
+
+  auto collect = [&]() {
+    job_t j = pending.front();
+    pending.pop_front();
+    double latency_ms;
+    runtime.wait(j.job, results.data(), probabilities, &latency_ms);
+    latencies.push_back(latency_ms);
+
+    // Top-1 / Top-5 Accuracy
+    const image_t &img = images[j.image];
+    int num_reported = std::min(5, (int)probabilities.size());
+    if (img.label >= 0) {
+      num_labeled++;
+      if (probabilities[0].second == img.label) num_top1++;
+      for (int i = 0; i < num_reported; i++)
+        if (probabilities[i].second == img.label) num_top5++;
+    }
+
+    // Per-Image Line: "<file> <label> <latency ms> <class>:<prob> ..."
+    fprintf(out, "%s %d %.3f", img.file.c_str(), img.label, latency_ms);
+    for (int i = 0; i < num_reported; i++)
+      fprintf(out, " %d:%.6f", probabilities[i].second,
+              probabilities[i].first);
+    fprintf(out, "\n");
+  };
+
+  clock::time_point start = clock::now();
+  for (int i = 0; i < (int)images.size(); i++) {
+    // Load Input Image (must contain exactly W x H x CH floats)
+    FILE *infile = fopen(images[i].file.c_str(), "rb");
+    size_t num_read = 0;
+    if (infile) {
+      num_read = fread(input.data(), sizeof(data_t), input.size(), infile);
+      fclose(infile);
+    }
+    if (num_read != input.size()) {
+      fprintf(out, "%s ERROR cannot read %d floats\n", images[i].file.c_str(),
+              (int)input.size());
+      num_failed++;
+      continue;
+    }
+
+    // Keep one Slot per pending Job (submit() would block forever)
+    while ((int)pending.size() >= runtime.numSlots()) collect();
+    job_t j = {i, -1};
+    j.job = runtime.submit(input.data());
+    pending.push_back(j);
+  }
+  while (!pending.empty()) collect();
+  double seconds =
+      std::chrono::duration<double>(clock::now() - start).count();
+
+  // ==========
+  // = Report =
+  // ==========
+  int num_done = latencies.size();
+  std::vector<double> sorted(latencies);
+  std::sort(sorted.begin(), sorted.end());
+  double mean = 0;
+  for (int i = 0; i < num_done; i++) mean += sorted[i] / num_done;
+  auto percentile = [&](double p) {
+    return num_done ? sorted[std::min(num_done - 1, (int)(p * num_done))] : 0;
+  };
+
+  fprintf(out, "\nRegression Result:\n====================\n");
+  fprintf(out, "    images:     %6d classified, %d failed\n", num_done,
+          num_failed);
+  if (num_labeled > 0) {
+    fprintf(out, "    top-1:      %6.2f%% (%d / %d)\n",
+            100.0 * num_top1 / num_labeled, num_top1, num_labeled);
+    fprintf(out, "    top-5:      %6.2f%% (%d / %d)\n",
+            100.0 * num_top5 / num_labeled, num_top5, num_labeled);
+  }
+  fprintf(out, "    latency:    mean %.3f ms, p50 %.3f ms, p95 %.3f ms, "
+               "max %.3f ms\n",
+          mean, percentile(0.5), percentile(0.95), percentile(1.0));
+  fprintf(out, "    throughput: %.2f images/s (%.3f s)\n",
+          num_done / std::max(seconds, 1e-9), seconds);
+  fflush(out);
+  return num_done;
+}
@@ -0,0 +1,35 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  regression.hpp
+//
+//  Parallel Regression Runner (accuracy + latency over many prepared inputs)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef REGRESSION_HPP_5C0E27B9
+#define REGRESSION_HPP_5C0E27B9
+
+#include <cstdio>
+#include "runtime.hpp"
+
+// ==================
+// = Run Regression =
+// ==================
+// Classifies all images of LIST_FILE on the given runtime (its instances
+// work in parallel: C-Sim and / or CPU engine, weights are shared) and
+// writes a report to OUT: top-1 / top-5 accuracy, latency, images/s.
+// LIST_FILE: one image per line, "<prepared input file> [<label>]"
+//    (files as produced by convert_image.py, relative paths are relative to
+//    the directory of LIST_FILE, label = expected class index, '#' comments)
+// Images without label only count for latency + throughput.
+// Latency: from submit() until the device finished the job (incl. queueing,
+// excl. waiting for the collection of earlier jobs in list order).
+// Returns number of classified images (-1: list file could not be read).
+int runRegression(AcceleratorRuntime &runtime, const char *list_file,
+                  FILE *out);
+
+#endif /* end of include guard: REGRESSION_HPP_5C0E27B9 */
@@ -0,0 +1,385 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  runtime.cpp
+//
+//  Persistent Accelerator Runtime (weights stay resident across requests)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#include "runtime.hpp"
+#include <cstring>
+#include <string>
+#include <poll.h>
+#include <unistd.h>
+
+// =============================
+// = Class ACCELERATOR RUNTIME =
+// =============================
+
+AcceleratorRuntime::AcceleratorRuntime(network_t *net, int num_topk,
+                                       int num_instances, int num_stages,
+                                       int num_cpu_instances, int num_slots)
+    : net(net), num_topk(num_topk), next_job(0), stopping(false) {
+  ch_out = net->layers[net->num_layers - 1].channels_out;
+  num_stages = std::max(1, std::min(num_stages, (int)net->num_layers));
+  num_cpu_instances = std::max(0, num_cpu_instances);
+  num_instances = std::max(num_stages - num_cpu_instances, num_instances);
+  num_instances = std::max(0, num_instances);
+  if (num_slots <= 0)
+    num_slots = NUM_JOB_SLOTS + (num_instances + num_cpu_instances - 1);
+  splitIntoStages(num_stages);
+  queues.resize(num_stages);
+
+  // Allocate Shared Memory for Config, Weights, Data Slots (once).
+  // Copy Layer Config + Weights to FPGA (once).
+  dram = setup_FPGA(net, num_slots);
+
+  weights_offset = ((long)dram.weights - (long)dram.base) / sizeof(data_t);
+  slots.resize(num_slots);
+  for (int i = 0; i < num_slots; i++) {
+    slots[i].state = SLOT_FREE;
+    slots[i].job = -1;
+    slots[i].stage = 0;
+    slots[i].data = dram.data + i * dram.data_slot_size;
+    slots[i].stats = dram.stats + i * dram.stats_slot_size;
+  }
+  last_stats.assign(dram.stats_slot_size, 0);
+
+  // Start one Device Thread per Accelerator Instance (FPGA, then CPU)
+  start_time = std::chrono::steady_clock::now();
+  instances.resize(num_instances + num_cpu_instances);
+  for (int i = 0; i < (int)instances.size(); i++) {
+    if (i < num_instances)
+      instances[i].cpu = NULL;
+    else if (i == num_instances)
+      instances[i].cpu = new CPUEngine(net);
+    else
+      instances[i].cpu = new CPUEngine(*instances[num_instances].cpu);
+    instances[i].stage = i % num_stages;
+    instances[i].jobs_done = 0;
+    instances[i].busy_seconds = 0;
+    instances[i].device =
+        std::thread(&AcceleratorRuntime::deviceThread, this, i);
+  }
+}
+
+AcceleratorRuntime::~AcceleratorRuntime() {
+  {
+    // Wait until all submitted Jobs have passed all Pipeline Stages
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int i = 0; i < (int)slots.size(); i++)
+      while (slots[i].state != SLOT_FREE && slots[i].state != SLOT_DONE)
+        slot_changed.wait(lock);
+    stopping = true;
+  }
+  slot_changed.notify_all();
+  for (int i = 0; i < (int)instances.size(); i++) instances[i].device.join();
+  // (first CPU Engine owns the shared weights: delete last)
+  for (int i = instances.size() - 1; i >= 0; i--) delete instances[i].cpu;
+}
+
+int AcceleratorRuntime::inputSize() {
+  layer_t *layer0 = &net->layers[0];
+  return layer0->width * layer0->height * layer0->channels_in;
+}
+
+int AcceleratorRuntime::outputSize() { return ch_out; }
+
+int AcceleratorRuntime::numSlots() { return slots.size(); }
+
+shared_dram_t &AcceleratorRuntime::sharedDRAM() { return dram; }
+
+void AcceleratorRuntime::printUtilization(FILE *out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  double lifetime = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start_time)
+                        .count();
+  fprintf(out, "CPU: Accelerator Utilization (%.3f s):\n", lifetime);
+  for (int i = 0; i < (int)instances.size(); i++) {
+    int stage = instances[i].stage;
+    fprintf(out,
+            "     instance %d (%s, layers %2d-%2d): %6d jobs, busy %8.3f s "
+            "(%5.1f%%)\n",
+            i, instances[i].cpu ? "CPU " : "FPGA", stage_first_layer[stage],
+            stage_last_layer[stage],
+            instances[i].jobs_done, instances[i].busy_seconds,
+            100 * instances[i].busy_seconds / std::max(lifetime, 1e-9));
+  }
+}
+
+void AcceleratorRuntime::printPerfCounters(FILE *out) {
+  std::lock_guard<std::mutex> lock(mutex);
+  print_FPGA_perf_counters(net, last_stats.data(), out);
+}
+
+// Split Layers into Pipeline Stages with similar Number of Operations (MACs)
+void AcceleratorRuntime::splitIntoStages(int num_stages) {
+  int num_layers = net->num_layers;
+  std::vector<double> ops(num_layers);
+  double total_ops = 0;
+  for (int l = 0; l < num_layers; l++) {
+    layer_t *layer = &net->layers[l];
+    ops[l] = (double)(layer->width / layer->stride) *
+             (layer->height / layer->stride) * layer->channels_in *
+             (layer->channels_out / layer->groups) * layer->kernel *
+             layer->kernel;
+    total_ops += ops[l];
+  }
+
+  stage_first_layer.assign(1, 0);
+  stage_last_layer.clear();
+  double ops_done = 0;
+  for (int l = 0; l < num_layers; l++) {
+    ops_done += ops[l];
+    int stage = stage_first_layer.size() - 1;
+    int stages_left = num_stages - 1 - stage;
+    int layers_left = num_layers - 1 - l;
+    // End Stage when its Share of Operations is reached (keep >= 1 layer
+    // for each remaining stage), last Stage ends with last Layer
+    bool share_reached = ops_done >= total_ops * (stage + 1) / num_stages;
+    if (stages_left > 0 &&
+        ((share_reached && layers_left >= stages_left) ||
+         layers_left == stages_left)) {
+      stage_last_layer.push_back(l);
+      stage_first_layer.push_back(l + 1);
+    }
+  }
+  stage_last_layer.push_back(num_layers - 1);
+}
+
+void AcceleratorRuntime::classify(
+    data_t *image, data_t *results,
+    std::vector<std::pair<data_t, int> > &probabilities) {
+  wait(submit(image), results, probabilities);
+}
+
+int AcceleratorRuntime::submit(data_t *image) {
+  // Claim free Slot
+  std::chrono::steady_clock::time_point submitted =
+      std::chrono::steady_clock::now();
+  int slot = -1, job;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (slot < 0) {
+      for (int i = 0; i < (int)slots.size() && slot < 0; i++)
+        if (slots[i].state == SLOT_FREE) slot = i;
+      if (slot < 0) slot_changed.wait(lock);
+    }
+    job = next_job++;
+    slots[slot].state = SLOT_LOADING;
+    slots[slot].job = job;
+    slots[slot].submitted = submitted;
+  }
+
+  // Copy onto FPGA (only Input Data, Config + Weights are resident)
+  // (clear counters: layers executed by the CPU engine stay zero)
+  copy_input_image_to_FPGA(net, image, slots[slot].data);
+  memset(slots[slot].stats, 0, dram.stats_slot_size * sizeof(data_t));
+
+  // Hand over to Device Thread (first Pipeline Stage)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    slots[slot].state = SLOT_QUEUED;
+    slots[slot].stage = 0;
+    queues[0].push_back(slot);
+  }
+  slot_changed.notify_all();
+  return job;
+}
+
+void AcceleratorRuntime::wait(
+    int job, data_t *results,
+    std::vector<std::pair<data_t, int> > &probabilities, double *latency_ms) {
+  // Find Slot of Job, wait until finished
+  int slot = -1;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int i = 0; i < (int)slots.size(); i++)
+      if (slots[i].state != SLOT_FREE && slots[i].job == job) slot = i;
+    assert(slot >= 0 && "Job unknown or already collected!");
+    while (slots[slot].state != SLOT_DONE) slot_changed.wait(lock);
+  }
+  if (latency_ms)
+    *latency_ms = std::chrono::duration<double, std::milli>(
+                      slots[slot].done - slots[slot].submitted)
+                      .count();
+
+  // Copy Results back from FPGA + Calculate Softmax
+  probabilities.resize(ch_out);
+  if (num_topk > 0) {
+    // FPGA already selected Top-K + calculated softmax normalizer
+    copy_topk_results_from_FPGA(net, results, probabilities, num_topk,
+                                slots[slot].data);
+  } else {
+    copy_results_from_FPGA(net, results, ch_out, slots[slot].data);
+    calculate_softmax(net, results, probabilities);
+  }
+
+  // Release Slot (keep its Performance Counters)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::copy(slots[slot].stats, slots[slot].stats + dram.stats_slot_size,
+              last_stats.begin());
+    slots[slot].state = SLOT_FREE;
+    slots[slot].job = -1;
+  }
+  slot_changed.notify_all();
+}
+
+void AcceleratorRuntime::deviceThread(int instance) {
+  int stage = instances[instance].stage;
+  std::deque<int> &queue = queues[stage];
+  while (true) {
+    // Next queued Slot (finish all queued Jobs before stopping)
+    int slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (queue.empty() && !stopping) slot_changed.wait(lock);
+      if (queue.empty()) return;
+      slot = queue.front();
+      queue.pop_front();
+      slots[slot].state = SLOT_RUNNING;
+    }
+
+    // Execute FPGA Accelerator Instance (or CPU Engine) on this Slot's Data
+    // Section
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    int input_offset =
+        ((long)slots[slot].data - (long)dram.base) / sizeof(data_t);
+    int stats_offset =
+        ((long)slots[slot].stats - (long)dram.base) / sizeof(data_t);
+    if (instances[instance].cpu) {
+      instances[instance].cpu->run(slots[slot].data, num_topk,
+                                   stage_first_layer[stage],
+                                   stage_last_layer[stage]);
+    } else {
+      fpga_top((data_t *)dram.base, net->num_layers, weights_offset,
+               input_offset, num_topk, stage_first_layer[stage],
+               stage_last_layer[stage], stats_offset);
+    }
+    double busy = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+    // Hand over to next Pipeline Stage, or Results are ready
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stage + 1 < (int)queues.size()) {
+        slots[slot].state = SLOT_QUEUED;
+        slots[slot].stage = stage + 1;
+        queues[stage + 1].push_back(slot);
+      } else {
+        slots[slot].state = SLOT_DONE;
+        slots[slot].done = std::chrono::steady_clock::now();
+      }
+      instances[instance].jobs_done++;
+      instances[instance].busy_seconds += busy;
+    }
+    slot_changed.notify_all();
+  }
+}
+
+// ===============
+// = Daemon Mode =
+// ===============
+
+int AcceleratorRuntime::serve(int in_fd, FILE *out) {
+  typedef std::chrono::steady_clock clock;
+  struct request_t {
+    std::string file;
+    int job;  // -1 = failed, error message in file
+    clock::time_point start;
+  };
+  std::deque<request_t> pending;  // in request order
+  std::vector<data_t> image(inputSize());
+  std::vector<data_t> results(ch_out);
+  std::vector<std::pair<data_t, int> > probabilities;
+  int num_served = 0;
+
+  // Answer oldest Request (blocks until its Job has finished)
+  auto respond = [&]() {
+    request_t req = pending.front();
+    pending.pop_front();
+    if (req.job < 0) {
+      fprintf(out, "%s\n", req.file.c_str());
+    } else {
+      wait(req.job, results.data(), probabilities);
+      double latency_ms = std::chrono::duration<double, std::milli>(
+                              clock::now() - req.start)
+                              .count();
+      int num_reported = std::min(5, (int)probabilities.size());
+      fprintf(out, "%s OK %.3f", req.file.c_str(), latency_ms);
+      for (int i = 0; i < num_reported; i++)
+        fprintf(out, " %d:%.6f", probabilities[i].second,
+                probabilities[i].first);
+      fprintf(out, "\n");
+      num_served++;
+    }
+    fflush(out);
+  };
+
+  std::string input;
+  bool end_of_input = false;
+  while (true) {
+    size_t newline = input.find('\n');
+
+    // No complete Request available: answer pending Requests while no more
+    // input arrives, otherwise read more input (blocking)
+    if (newline == std::string::npos) {
+      struct pollfd pfd = {in_fd, POLLIN, 0};
+      if (end_of_input && pending.empty()) break;
+      if (end_of_input || (!pending.empty() && poll(&pfd, 1, 0) == 0)) {
+        respond();
+        continue;
+      }
+      char buffer[4096];
+      ssize_t num_read = read(in_fd, buffer, sizeof(buffer));
+      if (num_read <= 0) {
+        end_of_input = true;
+        if (!input.empty()) input += '\n';  // last line without newline
+      } else {
+        input.append(buffer, num_read);
+      }
+      continue;
+    }
+
+    // Request: one file name per line (empty lines are ignored)
+    std::string file = input.substr(0, newline);
+    input.erase(0, newline + 1);
+    if (!file.empty() && file[file.size() - 1] == '\r')
+      file.erase(file.size() - 1);
+    if (file.empty()) continue;
+
+    // Keep one Slot per pending Request (submit() would block forever)
+    while ((int)pending.size() >= numSlots()) respond();
+
+    // Load Input Image (must contain exactly W x H x CH floats)
+    request_t req = {file, -1, clock::now()};
+    FILE *infile = fopen(file.c_str(), "rb");
+    if (!infile) {
+      req.file += " ERROR cannot open file";
+      pending.push_back(req);
+      continue;
+    }
+    size_t num_read = fread(image.data(), sizeof(data_t), image.size(), infile);
+    fclose(infile);
+    if (num_read != image.size()) {
+      char reason[64];
+      snprintf(reason, sizeof(reason), " ERROR expected %d floats, got %d",
+               (int)image.size(), (int)num_read);
+      req.file += reason;
+      pending.push_back(req);
+      continue;
+    }
+
+    // Submit Job (runs while next Requests are read + loaded)
+    req.job = submit(image.data());
+    pending.push_back(req);
+  }
+  return num_served;
+}
@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+//  SqueezeNetOnFPGA
+//------------------------------------------------------------------------------
+//
+//	File:  runtime.hpp
+//
+//  Persistent Accelerator Runtime (weights stay resident across requests)
+//
+//	(c) David Gschwend, 2016
+//
+//------------------------------------------------------------------------------
+
+#ifndef RUNTIME_HPP_7B20E9F4
+#define RUNTIME_HPP_7B20E9F4
+
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "cpu_top.hpp"
+#include "cpu_engine.hpp"
+
+// =============================
+// = Class ACCELERATOR RUNTIME =
+// =============================
+// Sets up the shared DRAM (layer config + weights) once, then classifies
+// any number of images. Per image, only the input is copied to the FPGA
+// and the (Top-K) results are read back.
+//
+// Asynchronous Job Queue: the shared DRAM holds several data sections
+// (job slots). Device threads execute queued slots in submission order
+// (in C-Simulation: call fpga_top()), while the host copies the next image
+// into a free slot and postprocesses finished ones.
+//
+// Multiple Accelerator Instances: one device thread per instance, each takes
+// the next queued job as soon as it is free. All instances share the
+// read-only layer config + weights, only the data sections are per job.
+//
+// Layer Pipelining: with num_stages > 1, the network is split into stages
+// (consecutive layer ranges with similar number of operations). Instance i
+// only executes stage (i % num_stages); a job moves from stage to stage,
+// its intermediate feature maps stay in the job's data section.
+//
+// CPU Fallback: num_cpu_instances additional instances execute their jobs
+// (or stages) with the CPUEngine, e.g. while the FPGA is busy. All CPU
+// instances share one copy of the repacked weights. With CPU instances,
+// num_instances may be 0 (pure CPU execution, e.g. for regression runs).
+class AcceleratorRuntime {
+ public:
+  // num_instances is raised if there are less instances than num_stages
+  // num_slots = 0: NUM_JOB_SLOTS + (num_instances + num_cpu_instances - 1)
+  AcceleratorRuntime(network_t *net, int num_topk = NUM_TOPK_ON_FPGA,
+                     int num_instances = NUM_ACCELERATOR_INSTANCES,
+                     int num_stages = 1, int num_cpu_instances = 0,
+                     int num_slots = 0);
+  ~AcceleratorRuntime();  // finishes queued jobs, stops device threads
+  // Number of floats per input image (W x H x CH of first layer)
+  int inputSize();
+  // Number of class scores per result (CH_OUT of last layer)
+  int outputSize();
+  int numSlots();
+  // Shared DRAM regions (e.g. for debugging)
+  shared_dram_t &sharedDRAM();
+  // Print stage, jobs + utilization (busy time / lifetime) per instance
+  void printUtilization(FILE *out);
+  // Print FPGA performance counters of the last collected job (per layer)
+  void printPerfCounters(FILE *out);
+  // Classify one image synchronously (= submit() + wait())
+  // image: prepared with convert_image.py
+  // results[]: class scores (ch_out entries, only Top-K set if num_topk > 0)
+  // probabilities: (probability, class), sorted by descending probability
+  void classify(data_t *image, data_t *results,
+                std::vector<std::pair<data_t, int> > &probabilities);
+  // Copy image into a free job slot + queue it, returns job id.
+  // Blocks while all slots are occupied (by queued, running or finished
+  // jobs): never submit more than numSlots() jobs without wait()ing!
+  int submit(data_t *image);
+  // Block until job has finished, read back results, release its slot
+  // latency_ms (optional): from submit() until the device thread finished
+  // the job (excl. the delay until it is collected by wait())
+  void wait(int job, data_t *results,
+            std::vector<std::pair<data_t, int> > &probabilities,
+            double *latency_ms = NULL);
+  // Daemon Mode: read one prepared input file name per line from IN_FD,
+  // answer each with one line on OUT (in request order, flushed):
+  //   "<file> OK <latency ms> <class>:<probability> ..."  (top-5 classes)
+  //   "<file> ERROR <reason>"
+  // Up to numSlots() requests are in flight. Returns number of served images
+  // (at end of input).
+  int serve(int in_fd, FILE *out);
+
+ private:
+  typedef enum {
+    SLOT_FREE,
+    SLOT_LOADING,  // host copies input image
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_DONE  // results ready, waiting for wait()
+  } slotstate_t;
+  struct jobslot_t {
+    slotstate_t state;
+    int job;
+    int stage;     // next / currently executed pipeline stage
+    data_t *data;   // data section in shared DRAM
+    data_t *stats;  // performance counters in shared DRAM
+    std::chrono::steady_clock::time_point submitted;  // submit() called
+    std::chrono::steady_clock::time_point done;       // state -> SLOT_DONE
+  };
+  struct instance_t {
+    std::thread device;
+    CPUEngine *cpu;  // NULL: FPGA accelerator, else CPU fallback
+    int stage;       // pipeline stage executed by this instance
+    int jobs_done;
+    double busy_seconds;
+  };
+  void deviceThread(int instance);
+  void splitIntoStages(int num_stages);
+
+  network_t *net;
+  int num_topk;
+  int ch_out;
+  shared_dram_t dram;
+  int weights_offset;
+  std::vector<jobslot_t> slots;
+  std::vector<data_t> last_stats;  // copied from slot by wait()
+  std::vector<int> stage_first_layer;
+  std::vector<int> stage_last_layer;
+  // slots waiting for device, per pipeline stage, in submission order
+  std::vector<std::deque<int> > queues;
+  int next_job;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable slot_changed;
+  std::vector<instance_t> instances;
+  std::chrono::steady_clock::time_point start_time;
+};
+
+#endif
@@ -18,11 +18,20 @@
 #include "weights_cache.hpp"
 #include "output_cache.hpp"
 #include "processing_element.hpp"
+#include "pooling_cache.hpp"
+
+#ifdef HLS_STREAM_SPSC
+#include <atomic>
+#include <thread>
+#include "hls_stream.h"
+#endif
 
 // =============================
 // = ACTIVATION / DEACTIVATION =
 // =============================
+#ifndef DO_UNITTESTS
 #define DO_UNITTESTS 0
+#endif
 
 // ==================
 // = Test Functions =
@@ -82,7 +91,7 @@ bool test_MemoryController() {
   layer1.mem_addr_weights = 0;
   layer1.mem_addr_input = 0;
   layer1.mem_addr_output = 100;
-  layer1.is_expand_layer = true;
+  layer1.out_pixel_stride = 2 * layer1.channels_out;
   // print_layer(&layer1);
   layer_t layer2("LAYER2", LAYER_NONE, 14, 12, 8, 16, 1, 0, 2);
   layer2.mem_addr_weights = 100;
@@ -90,7 +99,7 @@ bool test_MemoryController() {
   layer2.mem_addr_output = 200;
   layer2.pool = POOL_GLOBAL;
   layer_to_floats(layer1, &TEST_MEMORY[0]);
-  layer_to_floats(layer2, &TEST_MEMORY[12]);
+  layer_to_floats(layer2, &TEST_MEMORY[NUM_FLOATS_PER_LAYER]);
 
   // Test Constructor
   MemoryController DRAM(TEST_MEMORY, 100, 500);
@@ -113,7 +122,8 @@ bool test_MemoryController() {
   EXPECT_EQUAL(layer.mem_addr_input, 0);
   EXPECT_EQUAL(layer.mem_addr_output, 100);
   EXPECT_EQUAL(layer.mem_addr_weights, 0);
-  EXPECT_EQUAL(layer.is_expand_layer, true);
+  EXPECT_EQUAL(layer.out_pixel_stride, 16);
+  EXPECT_EQUAL(layer.out_channel_offset, 0);
   EXPECT_EQUAL(layer.pool, POOL_NONE);
   layer = CONFIG[1];
   EXPECT_EQUAL(layer.width, 14);
@@ -126,7 +136,8 @@ bool test_MemoryController() {
   EXPECT_EQUAL(layer.mem_addr_input, 100);
   EXPECT_EQUAL(layer.mem_addr_output, 200);
   EXPECT_EQUAL(layer.mem_addr_weights, 100);
-  EXPECT_EQUAL(layer.is_expand_layer, false);
+  EXPECT_EQUAL(layer.out_pixel_stride, 16);
+  EXPECT_EQUAL(layer.out_channel_offset, 0);
   EXPECT_EQUAL(layer.pool, POOL_GLOBAL);
 
   printf("    - setLayerConfig()\n");
@@ -157,27 +168,47 @@ bool test_MemoryController() {
   EXPECT_EQUAL(DRAM.loadNextChannel(), 546);
   EXPECT_EQUAL(DRAM.loadNextChannel(), 547);
 
+  printf("    - cycle counters\n");
+  // C-Sim model (no timestamp): one cycle per iteration, DRAM reads stall
+  PerfCounters &Stats = DRAM.perfCounters();
+  Stats.startLayer();
+  DRAM.loadNextChannel();
+  DRAM.loadNextWeight();
+  Stats.endLayer();
+  EXPECT_EQUAL(Stats.get(PERF_CYCLES), (counter_t)2);
+  EXPECT_EQUAL(Stats.get(PERF_STALL_CYCLES), (counter_t)2);
+  // RTL timestamp: differences of the samples, also across a wrap-around
+  volatile unsigned int timestamp = 0xFFFFFFF0u;
+  Stats.setCycleTimestamp(&timestamp);
+  Stats.startLayer();
+  DRAM.loadNextChannel();
+  timestamp = 0x10;
+  Stats.endLayer();
+  EXPECT_EQUAL(Stats.get(PERF_CYCLES), (counter_t)0x20);
+  EXPECT_EQUAL(Stats.get(PERF_STALL_CYCLES), (counter_t)0);
+  Stats.setCycleTimestamp(NULL);
+
   printf("    - writeBackOuputPixel()\n");
   DRAM.setLayerConfig(CONFIG[0]);  // Output Addr. is 600+
-  data_t OUTPUT[8];
-  for (int i = 0; i < 8; i++) OUTPUT[i] = i;
+  OutputCache OUTPUT;
+  for (int i = 0; i < 8; i++) OUTPUT.setChannel(i, i);
 
-  DRAM.writeBackOutputPixel(0, 0, OUTPUT);
+  DRAM.writeBackOutputPixel(0, 0, &OUTPUT);
   EXPECT_EQUAL(TEST_MEMORY[600], 0);
   EXPECT_EQUAL(TEST_MEMORY[601], 1);
   EXPECT_EQUAL(TEST_MEMORY[602], 2);
   EXPECT_EQUAL(TEST_MEMORY[603], 3);
   EXPECT_EQUAL(TEST_MEMORY[607], 7);
 
-  DRAM.writeBackOutputPixel(3, 4, OUTPUT);
-  // ch_out: 8, width_out: 15, y: 3, x: 4, is_expand_layer -> ch_out=16
+  DRAM.writeBackOutputPixel(3, 4, &OUTPUT);
+  // ch_out: 8, width_out: 15, y: 3, x: 4, out_pixel_stride=16
   int addr = 600 + 3 * (15 * 16) + 4 * 16;
   EXPECT_EQUAL(TEST_MEMORY[addr + 0], 0);
   EXPECT_EQUAL(TEST_MEMORY[addr + 1], 1);
   EXPECT_EQUAL(TEST_MEMORY[addr + 7], 7);
 
   DRAM.setLayerConfig(CONFIG[1]);  // Output Addr. is 700+
-  DRAM.writeBackOutputPixel(2, 1, OUTPUT);
+  DRAM.writeBackOutputPixel(2, 1, &OUTPUT);
   // ch_out: 16, width_out: 14, y: 2, x: 1, stride2 -> width_out = 7
   addr = 700 + 2 * (7 * 16) + 1 * 16;
   EXPECT_EQUAL(TEST_MEMORY[addr + 0], 0);
@@ -186,10 +217,59 @@ bool test_MemoryController() {
 
   printf("    - writeBackResult()\n");
   DRAM.setLayerConfig(CONFIG[0]);  // ch_out: 8
-  DRAM.writeBackResult(OUTPUT);    // written to 500+
-  EXPECT_EQUAL(TEST_MEMORY[500 + 0], 0);
-  EXPECT_EQUAL(TEST_MEMORY[500 + 1], 1);
-  EXPECT_EQUAL(TEST_MEMORY[500 + 7], 7);
+  DRAM.writeBackResult(&OUTPUT);   // written to 500+
+  // width_out: 15, height_out: 13 -> divided by 195 if GPOOL_AVERAGE_ON_FPGA
+  data_t gpool_div = GPOOL_AVERAGE_ON_FPGA ? (15 * 13) : 1;
+  EXPECT_EQUAL(TEST_MEMORY[500 + 0], 0 / gpool_div);
+  EXPECT_EQUAL(TEST_MEMORY[500 + 1], 1 / gpool_div);
+  EXPECT_EQUAL(TEST_MEMORY[500 + 7], 7 / gpool_div);
+
+  return success;
+}
+
+// Top-K Result of the last Layer (global pooling of 4 x 2 output pixels):
+// (class, score) pairs ordered by score, ties by class index, followed by
+// the softmax normalizer sum_i(e^(score_i - max)) at DRAM_DATA[2k]
+bool test_MemoryControllerTopK() {
+  printf(" MemoryController Top-K Test\n");
+  bool success = true;
+
+  const int CH = 10;
+  const int MEM_SIZE = 1000;
+  if (MAX_NUM_CHOUT < CH) {
+    printf("    (skipped: needs MAX_NUM_CHOUT >= %d)\n", CH);
+    return true;
+  }
+
+  // Layer    : ( NAME   , TYPE      , W, H,CI, CO, K, P, S)
+  layer_t layer("TOPK  ", LAYER_CONV, 4, 2, 1, CH, 1, 0, 1);
+  layer.pool = POOL_GLOBAL;
+  data_t TEST_MEMORY[MEM_SIZE];
+  MemoryController DRAM(TEST_MEMORY, 100, 500);
+  DRAM.setLayerConfig(layer);
+
+  // Global Pooling Sums: scores x 8 pixels, 3-way tie for the maximum
+  data_t scores[CH] = {3, 9, -2, 9, 0.5, 7, 1, -8, 4, 9};
+  OutputCache GPoolCache;
+  for (int i = 0; i < CH; i++) GPoolCache.setChannel(i, 8 * scores[i]);
+  double expsum = 0;
+  for (int i = 0; i < CH; i++) expsum += exp(scores[i] - 9);
+
+  // k < CH: best 4 only / k > CH: all CH classes
+  int num_topk[2] = {4, MAX_TOPK};
+  int order[CH] = {1, 3, 9, 5, 8, 0, 6, 4, 2, 7};
+  for (int t = 0; t < 2; t++) {
+    int k = std::min(num_topk[t], CH);
+    printf("    - writeBackTopK(%d)\n", num_topk[t]);
+    for (int i = 0; i < MEM_SIZE; i++) TEST_MEMORY[i] = 1000;
+    DRAM.writeBackTopK(&GPoolCache, num_topk[t]);
+    for (int j = 0; j < k; j++) {
+      EXPECT_EQUAL((int)TEST_MEMORY[500 + 2 * j], order[j]);
+      EXPECT_EQUAL(TEST_MEMORY[500 + 2 * j + 1], scores[order[j]]);
+    }
+    EXPECT_EQUAL(TEST_MEMORY[500 + 2 * k], expsum);
+    EXPECT_EQUAL(TEST_MEMORY[500 + 2 * k + 1], 1000);
+  }
 
   return success;
 }
@@ -238,7 +318,7 @@ bool test_WeightsCache() {
   layer1.mem_addr_weights = 0;
   layer1.mem_addr_input = 0;
   layer1.mem_addr_output = 100;
-  layer1.is_expand_layer = true;
+  layer1.out_pixel_stride = 2 * layer1.channels_out;
   // print_layer(&layer1);
   layer_t layer2("LAYER2", LAYER_NONE, 14, 12, 5, 4, 1, 0, 2);
   layer2.mem_addr_weights = 200;
@@ -246,7 +326,7 @@ bool test_WeightsCache() {
   layer2.mem_addr_output = 200;
   layer2.pool = POOL_GLOBAL;
   layer_to_floats(layer1, &TEST_MEMORY[0]);
-  layer_to_floats(layer2, &TEST_MEMORY[12]);
+  layer_to_floats(layer2, &TEST_MEMORY[NUM_FLOATS_PER_LAYER]);
 
   // Memory Controller
   MemoryController DRAM(TEST_MEMORY, 100, 500);
@@ -267,7 +347,7 @@ bool test_WeightsCache() {
   WCache.setInputChannel(0);
   printf("    - getNineWeights()\n");
   data_t weights[9];
-  WCache.getNineWeights(0, weights);
+  WCache.getNineWeights<3>(0, weights);
   // weight style: [chIn][chOut].[ky][kx]
   EXPECT_EQUAL(weights[0], 0.00);
   EXPECT_EQUAL(weights[1], 0.01);
@@ -279,7 +359,7 @@ bool test_WeightsCache() {
   EXPECT_EQUAL(weights[7], 0.21);
   EXPECT_EQUAL(weights[8], 0.22);
 
-  WCache.getNineWeights(2, weights);
+  WCache.getNineWeights<3>(2, weights);
   // weight style: [chIn][chOut].[ky][kx]
   EXPECT_EQUAL(weights[0], 2.00);
   EXPECT_EQUAL(weights[1], 2.01);
@@ -294,7 +374,7 @@ bool test_WeightsCache() {
   printf("    - setInputChannel()\n");
   WCache.setInputChannel(3);
 
-  WCache.getNineWeights(2, weights);
+  WCache.getNineWeights<3>(2, weights);
   // weight style: [chIn][chOut].[ky][kx]
   EXPECT_EQUAL(weights[0], 302.00);
   EXPECT_EQUAL(weights[1], 302.01);
@@ -309,19 +389,17 @@ bool test_WeightsCache() {
   printf("    - setLayerConfig()\n");
   DRAM.setLayerConfig(layer2);
   WCache.setLayerConfig(layer2);
-  WCache.print_setup();
 
   printf("    - loadFromDRAM()\n");
   WCache.loadFromDRAM(&DRAM);
 
   printf("    - sanityCheck\n");
-  WCache.print_setup();
 
   // weight style: [chIn][chOut].[ky][kx]
   printf("    - setInputChannel()\n");
   printf("    - getNineWeights()\n");
   WCache.setInputChannel(0);
-  WCache.getNineWeights(1, weights);
+  WCache.getNineWeights<1>(1, weights);
   EXPECT_EQUAL(weights[0], 0.00);
   EXPECT_EQUAL(weights[1], 0.00);
   EXPECT_EQUAL(weights[2], 0.00);
@@ -332,7 +410,7 @@ bool test_WeightsCache() {
   EXPECT_EQUAL(weights[7], 0.00);
   EXPECT_EQUAL(weights[8], 0.00);
   WCache.setInputChannel(3);
-  WCache.getNineWeights(3, weights);
+  WCache.getNineWeights<1>(3, weights);
   EXPECT_EQUAL(weights[0], 0.00);
   EXPECT_EQUAL(weights[1], 0.00);
   EXPECT_EQUAL(weights[2], 0.00);
@@ -346,6 +424,119 @@ bool test_WeightsCache() {
   return success;
 }
 
+// ===============================
+// = Grouped Conv: WCache and PE =
+// ===============================
+// Input pixel (y, x, ci) and filter weight (ci, co within group, ky, kx)
+// of the grouped convolution test
+static data_t groupTestPixel(int y, int x, int ci) {
+  return y * 10 + x + ci / 10.0;
+}
+static data_t groupTestWeight(int ci, int co, int ky, int kx) {
+  return ci * 100 + co * 10 + ky + kx / 10.0;
+}
+
+bool test_GroupedConvolution() {
+  printf(" Grouped Convolution Test\n");
+  bool success = true;
+
+  // 3x3 input, CI = 4, CO = 6 (groups = 2) and CI = CO = 4 (depthwise)
+  const int H = 3, W = 3, CI = 4, K = 3;
+  const int MEM_SIZE = 2000;
+  if (MAX_NUM_CHOUT < 6 || MAX_CHANNELS < 6 || MAX_DIMENSION < W ||
+      MAX_IMAGE_CACHE_SIZE < H * W * CI || MAX_WEIGHTS_PER_LAYER < 114) {
+    printf("    (skipped: needs MAX_NUM_CHOUT >= 6, "
+           "MAX_WEIGHTS_PER_LAYER >= 114)\n");
+    return true;
+  }
+
+  // DRAM: [WEIGHTS 100+, DATA 500+]
+  data_t TEST_MEMORY[MEM_SIZE];
+  MemoryController DRAM(TEST_MEMORY, 100, 500);
+  ImageCache ICache;
+  WeightsCache WCache;
+  OutputCache OCache;
+  ProcessingElement PE;
+  PE.setup(&ICache, &WCache, &OCache);
+
+  int chout[2] = {6, 4};
+  int groups[2] = {2, 4};
+  for (int g = 0; g < 2; g++) {
+    const int CO = chout[g], GROUPS = groups[g];
+    const int CI_G = CI / GROUPS, CO_G = CO / GROUPS;
+    printf("    - CI = %d, CO = %d, groups = %d\n", CI, CO, GROUPS);
+
+    // Layer    : ( NAME   , TYPE      , W, H,CI, CO, K, P, S)
+    layer_t layer("GROUP ", LAYER_CONV, W, H, CI, CO, K, 1, 1);
+    layer.groups = GROUPS;
+
+    // weight style: [chIn][chOut / groups].[ky][kx], then CO biases
+    for (int i = 0; i < MEM_SIZE; i++) TEST_MEMORY[i] = 1000;
+    int addr = 100;
+    for (int ci = 0; ci < CI; ci++)
+      for (int co = 0; co < CO_G; co++)
+        for (int ky = 0; ky < K; ky++)
+          for (int kx = 0; kx < K; kx++)
+            TEST_MEMORY[addr++] = groupTestWeight(ci, co, ky, kx);
+    for (int co = 0; co < CO; co++) TEST_MEMORY[addr++] = -co;
+
+    DRAM.setLayerConfig(layer);
+    WCache.setLayerConfig(layer);
+    ICache.setLayerConfig(layer);
+    PE.setLayerConfig(layer);
+    WCache.loadFromDRAM(&DRAM);
+
+    printf("    - getNineWeights() / getOneWeight()\n");
+    data_t weights[9];
+    for (int ci = 0; ci < CI; ci++) {
+      WCache.setInputChannel(ci);
+      for (int co = 0; co < CO_G; co++) {
+        WCache.getNineWeights<3>(co, weights);
+        for (int i = 0; i < 9; i++)
+          EXPECT_EQUAL(weights[i], groupTestWeight(ci, co, i / 3, i % 3));
+      }
+    }
+    // biases behind all (CI * CO / groups) filters
+    WCache.setInputChannel(CI);
+    for (int co = 0; co < CO; co++) EXPECT_EQUAL(WCache.getOneWeight(co), -co);
+
+    // Image Cache holds the entire 3x3 input
+    for (int y = 0; y < H; y++)
+      for (int x = 0; x < W; x++)
+        for (int ci = 0; ci < CI; ci++)
+          ICache.setNextChannel(groupTestPixel(y, x, ci));
+
+    // Output pixels (1, 1) and (0, 0) (zero-padded corner)
+    printf("    - processInputChannel()\n");
+    for (int p = 0; p < 2; p++) {
+      const int y = 1 - p, x = 1 - p;
+      OCache.reset();
+      for (int ci = 0; ci < CI; ci++) PE.processInputChannel<3, 1>(y, x, ci);
+
+      // Reference: CH_OUT co only sums up CH_IN of its own group
+      for (int co = 0; co < CO; co++) {
+        const int group = co / CO_G;
+        data_t ref = 0.0f;
+        for (int ci = group * CI_G; ci < (group + 1) * CI_G; ci++) {
+          data_t acc = 0.0f;
+          for (int ky = 0; ky < K; ky++) {
+            for (int kx = 0; kx < K; kx++) {
+              int yy = y + ky - 1, xx = x + kx - 1;
+              bool pad = (yy < 0 || xx < 0 || yy >= H || xx >= W);
+              data_t px = pad ? 0.0f : groupTestPixel(yy, xx, ci);
+              acc += px * groupTestWeight(ci, co % CO_G, ky, kx);
+            }
+          }
+          ref += acc;
+        }
+        EXPECT_EQUAL(OCache.getChannel(co), ref);
+      }
+    }
+  }
+
+  return success;
+}
+
 // ===============
 // = Image Cache =
 // ===============
@@ -389,7 +580,7 @@ bool test_ImageCache() {
   layer1.mem_addr_weights = 0;
   layer1.mem_addr_input = 0;
   layer1.mem_addr_output = 400;
-  layer1.is_expand_layer = true;
+  layer1.out_pixel_stride = 2 * layer1.channels_out;
   // print_layer(&layer1);
   layer_t layer2("LAYER2", LAYER_NONE, 4, 4, 8, 4, 1, 0, 2);
   layer2.mem_addr_weights = 200;
@@ -397,7 +588,7 @@ bool test_ImageCache() {
   layer2.mem_addr_output = 600;
   layer2.pool = POOL_GLOBAL;
   layer_to_floats(layer1, &TEST_MEMORY[0]);
-  layer_to_floats(layer2, &TEST_MEMORY[12]);
+  layer_to_floats(layer2, &TEST_MEMORY[NUM_FLOATS_PER_LAYER]);
 
   // Memory Controller
   MemoryController DRAM(TEST_MEMORY, 100, 500);
@@ -455,7 +646,7 @@ bool test_ImageCache() {
 
 // ================
 // = Output Cache =
-// =================
+// ================
 bool test_OutputCache() {
   printf(" OutputCache Test\n");
   bool success = true;
@@ -495,6 +686,392 @@ bool test_OutputCache() {
   return success;
 }
 
+// =================
+// = Pooling Cache =
+// =================
+// CONV output pixel (y, x, c) of the pooling test: mostly negative, no
+// order along y / x (first pixel of a window must initialize, not max())
+static data_t poolTestPixel(int y, int x, int c) {
+  return ((y * 13 + x * 7 + c * 5) % 17) - 12.0 + c / 10.0;
+}
+
+bool test_PoolingCache() {
+  printf(" PoolingCache Test\n");
+  bool success = true;
+
+  // Odd-sized CONV output: H = 5, W = 7, CH = 3 (stride 1, 1x1 kernel)
+  const int H = 5, W = 7, CH = 3;
+  const int MEM_SIZE = 2000;
+  // (PoolingCache::BRAM holds >= 24 words in unit tests, see fpga_top.hpp)
+  if (POOL_CACHE_BRAM_SIZE < 2 * 4 * CH || MAX_NUM_CHOUT < CH) {
+    printf("    (skipped: needs POOL_CACHE_BRAM_SIZE >= %d)\n", 2 * 4 * CH);
+    return true;
+  }
+
+  // DRAM: [DATA 500+], untouched words stay 1000
+  data_t TEST_MEMORY[MEM_SIZE];
+  MemoryController DRAM(TEST_MEMORY, 100, 500);
+  OutputCache OCache;
+  PoolingCache PCache;
+
+  // Layer    : ( NAME   , TYPE      , W, H,CI, CO, K, P, S)
+  layer_t layer("POOL  ", LAYER_CONV, W, H, 1, CH, 1, 0, 1);
+  layer.mem_addr_output = 0;
+
+  // 3x3S2 first (leaves stale partial maxima in the cache for 2x2S2)
+  // Caffe: pooled dimension rounded up, last windows clipped at the border
+  pooltype_t pools[2] = {POOL_3x3S2, POOL_2x2S2};
+  int kernels[2] = {3, 2};
+  int heights_out[2] = {2, 3};  // 3x3S2: rows 0-2, 2-4 / 2x2S2: ..., 4
+  int widths_out[2] = {3, 4};   // 3x3S2: cols 0-2, 2-4, 4-6 / 2x2S2: ..., 6
+  for (int p = 0; p < 2; p++) {
+    printf("    - poolPixel() %s\n", (p == 0) ? "3x3S2" : "2x2S2");
+    for (int i = 0; i < MEM_SIZE; i++) TEST_MEMORY[i] = 1000;
+    layer.pool = pools[p];
+    DRAM.setLayerConfig(layer);
+    DRAM.perfCounters().reset();
+    PCache.setLayerConfig(layer);
+    int h_out = pooled_dimension(H, layer.pool);
+    int w_out = pooled_dimension(W, layer.pool);
+    EXPECT_EQUAL(h_out, heights_out[p]);
+    EXPECT_EQUAL(w_out, widths_out[p]);
+
+    // CONV output pixels in order, as fpga_top
+    for (int y = 0; y < H; y++) {
+      for (int x = 0; x < W; x++) {
+        for (int c = 0; c < CH; c++)
+          OCache.setChannel(c, poolTestPixel(y, x, c));
+        PCache.poolPixel(y, x, &OCache, &DRAM);
+      }
+    }
+
+    // Reference Max Pooling (clipped windows)
+    for (int py = 0; py < h_out; py++) {
+      for (int px = 0; px < w_out; px++) {
+        for (int c = 0; c < CH; c++) {
+          data_t ref = -INFINITY;
+          for (int y = 2 * py; y < std::min(2 * py + kernels[p], H); y++)
+            for (int x = 2 * px; x < std::min(2 * px + kernels[p], W); x++)
+              ref = std::max(ref, poolTestPixel(y, x, c));
+          EXPECT_EQUAL(TEST_MEMORY[500 + (py * w_out + px) * CH + c], ref);
+        }
+      }
+    }
+    // every pooled pixel written back exactly once, nothing behind
+    EXPECT_EQUAL(TEST_MEMORY[500 + h_out * w_out * CH], 1000);
+    EXPECT_EQUAL(DRAM.perfCounters().get(PERF_WORDS_WRITTEN),
+                 (counter_t)(h_out * w_out * CH));
+  }
+
+  return success;
+}
+
+// =========================
+// = Bypass (Residual) Add =
+// =========================
+// Input pixel (y, x, ci) and bypass pixel (y, x, co) of the bypass test
+static data_t bypassTestPixel(int y, int x, int ci) {
+  return y * 4 + x + ci / 4.0;
+}
+static data_t bypassTestBypass(int y, int x, int co) {
+  return ((y * 5 + x * 3 + co * 7) % 11) - 5.0;
+}
+
+bool test_BypassAdd() {
+  printf(" Bypass Test\n");
+  bool success = true;
+
+  const int MEM_SIZE = 2000;
+  if (MAX_NUM_CHOUT < 4 || MAX_CHANNELS < 8 || MAX_DIMENSION < 4 ||
+      MAX_NUM_LAYERS < 1) {
+    printf("    (skipped: needs MAX_NUM_CHOUT >= 4, MAX_CHANNELS >= 8)\n");
+    return true;
+  }
+
+  // DRAM: [CONFIG 0+, WEIGHTS 100+, DATA 500+]
+  data_t TEST_MEMORY[MEM_SIZE];
+  for (int i = 0; i < MEM_SIZE; i++) TEST_MEMORY[i] = i;
+  MemoryController DRAM(TEST_MEMORY, 100, 500);
+  OutputCache BCache("BCache");
+
+  // loadBypassPixel(): stride-2 layer writing channels 2-4 of an 8-channel
+  // concatenated map -> bypass map has the same layout
+  // Layer    : ( NAME   , TYPE      , W, H,CI,CO, K, P, S)
+  layer_t layer("BYPASS", LAYER_CONV, 4, 4, 1, 3, 1, 0, 2);
+  layer.out_pixel_stride = 8;
+  layer.out_channel_offset = 2;
+  layer.has_bypass = true;
+  layer.mem_addr_bypass = 300;
+  DRAM.setLayerConfig(layer);
+  DRAM.perfCounters().reset();
+
+  printf("    - loadBypassPixel()\n");
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < 2; x++) {
+      for (int c = 0; c < MAX_NUM_CHOUT; c++) BCache.setChannel(c, -1.0f);
+      DRAM.loadBypassPixel(y, x, &BCache);
+      for (int co = 0; co < 3; co++)
+        EXPECT_EQUAL(BCache.getChannel(co),
+                     500 + 300 + (y * 2 + x) * 8 + 2 + co);
+      // only ch_out channels are loaded
+      EXPECT_EQUAL(BCache.getChannel(3), -1.0);
+    }
+  }
+  EXPECT_EQUAL(DRAM.perfCounters().get(PERF_WORDS_READ), (counter_t)(4 * 3));
+
+  // fpga_top(): single 1x1 layer (CI = 2, CO = 3) with bypass
+  // -> out = ReLU(conv + bias + bypass), bypass added before ReLU
+  const int H = 2, W = 3, CI = 2, CO = 3;
+  for (int i = 0; i < MEM_SIZE; i++) TEST_MEMORY[i] = 1000;
+  // Layer    : ( NAME   , TYPE      , W, H,CI, CO, K, P, S)
+  layer_t res("RES   ", LAYER_CONV, W, H, CI, CO, 1, 0, 1);
+  res.mem_addr_weights = 0;
+  res.mem_addr_input = 0;
+  res.mem_addr_bypass = 100;
+  res.mem_addr_output = 200;
+  res.has_bypass = true;
+  layer_to_floats(res, &TEST_MEMORY[0]);
+  // weight style: [chIn][chOut], then CO biases
+  const data_t weights[CI][CO] = {{1.0, -1.0, 0.5}, {-2.0, 1.0, 0.25}};
+  const data_t biases[CO] = {0.5, -8.0, -3.0};
+  for (int ci = 0; ci < CI; ci++)
+    for (int co = 0; co < CO; co++)
+      TEST_MEMORY[100 + ci * CO + co] = weights[ci][co];
+  for (int co = 0; co < CO; co++) TEST_MEMORY[100 + CI * CO + co] = biases[co];
+  // data style: [y][x].[ch]
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) {
+      for (int ci = 0; ci < CI; ci++)
+        TEST_MEMORY[500 + (y * W + x) * CI + ci] = bypassTestPixel(y, x, ci);
+      for (int co = 0; co < CO; co++)
+        TEST_MEMORY[500 + 100 + (y * W + x) * CO + co] =
+            bypassTestBypass(y, x, co);
+    }
+  }
+
+  printf("    - fpga_top() with bypass\n");
+  fpga_top(TEST_MEMORY, 1, 100, 500, 0, 0, 0, 0);
+  for (int y = 0; y < H; y++) {
+    for (int x = 0; x < W; x++) {
+      for (int co = 0; co < CO; co++) {
+        data_t raw = 0.0f;
+        for (int ci = 0; ci < CI; ci++)
+          raw += bypassTestPixel(y, x, ci) * weights[ci][co];
+        data_t ref = raw + biases[co] + bypassTestBypass(y, x, co);
+        ref = (ref < 0) ? 0.0f : ref;
+        EXPECT_EQUAL(TEST_MEMORY[500 + 200 + (y * W + x) * CO + co], ref);
+      }
+    }
+  }
+  // bypass map itself is left untouched, nothing written behind output
+  EXPECT_EQUAL(TEST_MEMORY[500 + 100], bypassTestBypass(0, 0, 0));
+  EXPECT_EQUAL(TEST_MEMORY[500 + 200 + H * W * CO], 1000);
+
+  return success;
+}
+
+// ==========================
+// = Activation Memory Plan =
+// ==========================
+// Small SqueezeNet-like network: conv, fire (expand concat), fire with
+// bypass, Inception-style branch (1x1 | 1x1 reduce -> 3x3, concatenated),
+// fused max pooling, global pooling
+static void buildPlanTestNetwork(network_t *net) {
+  // Layer            ( NAME   , TYPE    , W, H,CI,CO, K, P, S)
+  addLayer(net, layer_t("conv1 ", LAYER_CONV, 8, 8, 3, 8, 3, 1, 1));
+  addLayer(net, layer_t("f2/s  ", LAYER_CONV, 8, 8, 8, 4, 1, 0, 1));
+  addLayer(net, layer_t("f2/e1 ", LAYER_CONV, 8, 8, 4, 8, 1, 0, 1), true);
+  addLayer(net, layer_t("f2/e3 ", LAYER_CONV, 8, 8, 4, 8, 3, 1, 1), true,
+           false);
+  addLayer(net, layer_t("f3/s  ", LAYER_CONV, 8, 8, 16, 4, 1, 0, 1));
+  addLayer(net, layer_t("f3/e1 ", LAYER_CONV, 8, 8, 4, 8, 1, 0, 1), true,
+           true, POOL_NONE, 1, 4);
+  addLayer(net, layer_t("f3/e3 ", LAYER_CONV, 8, 8, 4, 8, 3, 1, 1), true,
+           false, POOL_NONE, 1, 4);
+  addConcatLayer(net, layer_t("i/1   ", LAYER_CONV, 8, 8, 16, 8, 1, 0, 1), 16);
+  addConcatLayer(net, layer_t("i/r   ", LAYER_CONV, 8, 8, 16, 4, 1, 0, 1), 4,
+                 true, POOL_NONE, 1, -1, 6);
+  addConcatLayer(net, layer_t("i/3   ", LAYER_CONV, 8, 8, 4, 8, 3, 1, 1), 16,
+                 false, POOL_NONE, 1, -1, 8, 7);
+  addLayer(net, layer_t("c4    ", LAYER_CONV, 8, 8, 16, 8, 1, 0, 1), false,
+           true, POOL_2x2S2);
+  addLayer(net, layer_t("c5    ", LAYER_CONV, 4, 4, 8, 8, 3, 1, 1));
+  addLayer(net, layer_t("c6    ", LAYER_CONV, 4, 4, 8, 8, 1, 0, 1), false,
+           true, POOL_GLOBAL);
+}
+
+bool test_ActivationMemoryPlan() {
+  printf(" Activation Memory Plan Test\n");
+  bool success = true;
+
+  const int NUM_LAYERS = 13;
+  if (MAX_NUM_LAYERS < NUM_LAYERS || MAX_DIMENSION < 8 || MAX_CHANNELS < 8) {
+    printf("    (skipped: needs MAX_NUM_LAYERS >= %d)\n", NUM_LAYERS);
+    return true;
+  }
+
+  int alignments[2] = {(int)sizeof(data_t), 64};  // Bytes
+  for (int a = 0; a < 2; a++) {
+    printf("    - planActivationMemory() (alignment %dB)\n", alignments[a]);
+    network_t net(NUM_LAYERS, 0);
+    net.mem_alignment = alignments[a];
+    buildPlanTestNetwork(&net);
+    EXPECT_EQUAL((int)net.num_layers, NUM_LAYERS);
+    const int align = alignments[a] / (int)sizeof(data_t);  // floats
+
+    // Lifetime of each tensor from the layers themselves: from its first
+    // writer up to its last reader (as input or bypass), unread tensors
+    // (not the image) stay alive until the end
+    int live_from[NUM_LAYERS + 1], live_until[NUM_LAYERS + 1];
+    for (int t = 0; t < net.num_tensors; t++) {
+      live_from[t] = (t == 0) ? -1 : NUM_LAYERS;
+      live_until[t] = -1;
+    }
+    for (int l = 0; l < NUM_LAYERS; l++) {
+      int o = net.output_tensor[l];
+      live_from[o] = std::min(live_from[o], l);
+      live_until[net.input_tensor[l]] = l;
+      if (net.bypass_tensor[l] >= 0) live_until[net.bypass_tensor[l]] = l;
+      EXPECT_EQUAL(net.input_tensor[l] != o, true);
+    }
+    for (int t = 1; t < net.num_tensors; t++)
+      if (live_until[t] < live_from[t]) live_until[t] = NUM_LAYERS;
+
+    // Addresses in Layer Configs match the Tensors, Bypass: same layout as
+    // output (concatenated map of the 2nd fire module's input)
+    int sum_sizes = 0;
+    for (int l = 0; l < NUM_LAYERS; l++) {
+      layer_t &layer = net.layers[l];
+      EXPECT_EQUAL((int)layer.mem_addr_input,
+                   net.tensors[net.input_tensor[l]].mem_addr);
+      EXPECT_EQUAL((int)layer.mem_addr_output,
+                   net.tensors[net.output_tensor[l]].mem_addr);
+      EXPECT_EQUAL(layer.has_bypass, (l == 5 || l == 6));
+      if (layer.has_bypass) {
+        EXPECT_EQUAL(net.bypass_tensor[l], net.input_tensor[4]);
+        EXPECT_EQUAL((int)layer.mem_addr_bypass,
+                     net.tensors[net.input_tensor[4]].mem_addr);
+      }
+    }
+    EXPECT_EQUAL(net.tensors[0].mem_addr, 0);
+    EXPECT_EQUAL(net.tensors[net.output_tensor[NUM_LAYERS - 1]].size, 0);
+
+    // Inception Branch: reduce reads the fire output, 3x3 reads the reduce
+    // output and writes behind the 1x1's channels, next layer reads both
+    EXPECT_EQUAL(net.input_tensor[8], net.output_tensor[6]);
+    EXPECT_EQUAL(net.input_tensor[9], net.output_tensor[8]);
+    EXPECT_EQUAL(net.output_tensor[9], net.output_tensor[7]);
+    EXPECT_EQUAL((int)net.layers[9].out_channel_offset, 8);
+    EXPECT_EQUAL((int)net.layers[9].out_pixel_stride, 16);
+    EXPECT_EQUAL(net.input_tensor[10], net.output_tensor[9]);
+
+    // No two tensors with overlapping lifetime share any address
+    for (int t = 0; t < net.num_tensors; t++) {
+      const tensor_t &T = net.tensors[t];
+      sum_sizes += T.size;
+      EXPECT_EQUAL(T.mem_addr % align, 0);
+      EXPECT_EQUAL(T.mem_addr + T.size <= net.total_pixel_mem, true);
+      for (int u = 0; u < t; u++) {
+        const tensor_t &U = net.tensors[u];
+        if (T.size == 0 || U.size == 0) continue;
+        bool live = live_from[t] <= live_until[u] &&
+                    live_from[u] <= live_until[t];
+        bool overlap = T.mem_addr < U.mem_addr + U.size &&
+                       U.mem_addr < T.mem_addr + T.size;
+        if (live && overlap)
+          printf("ERROR: tensors %d and %d overlap while both alive\n", t, u);
+        success &= !(live && overlap);
+      }
+    }
+    // Final Result (Top-K: 2 * CH_OUT + 1) fits, dead tensors are reused
+    EXPECT_EQUAL(net.total_pixel_mem >= 2 * 8 + 1, true);
+    EXPECT_EQUAL(net.total_pixel_mem < sum_sizes, true);
+  }
+
+  return success;
+}
+
+// ============================
+// = hls::stream (SPSC C-Sim) =
+// ============================
+// Lock-free stream model of vivado_include/hls_stream_spsc.h (only built
+// with -DHLS_STREAM_SPSC, see "make unittests_spsc")
+#ifdef HLS_STREAM_SPSC
+bool test_HlsStreamSPSC() {
+  printf(" hls::stream (SPSC) Test\n");
+  bool success = true;
+  int value;
+
+  // FIFO depth, not rounded up to the ring buffer capacity
+  printf("    - depth / full() / write_nb()\n");
+  hls::stream<int> fifo("fifo", 3);
+  EXPECT_EQUAL((int)fifo.depth(), 3);
+  EXPECT_EQUAL(fifo.empty(), true);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQUAL(fifo.full(), false);
+    fifo.write(i);
+  }
+  EXPECT_EQUAL(fifo.full(), true);
+  EXPECT_EQUAL((int)fifo.size(), 3);
+  // full FIFO: element dropped, as in hardware
+  EXPECT_EQUAL(fifo.write_nb(99), false);
+  EXPECT_EQUAL((int)fifo.size(), 3);
+  for (int i = 0; i < 3; i++) EXPECT_EQUAL(fifo.read(), i);
+  EXPECT_EQUAL(fifo.read_nb(value), false);
+  EXPECT_EQUAL(fifo.write_nb(7), true);
+  EXPECT_EQUAL(fifo.read_nb(value), true);
+  EXPECT_EQUAL(value, 7);
+
+  fifo.set_depth(5);
+  for (int i = 0; i < 5; i++) EXPECT_EQUAL(fifo.write_nb(i), true);
+  EXPECT_EQUAL(fifo.full(), true);
+  EXPECT_EQUAL(fifo.write_nb(5), false);
+  for (int i = 0; i < 5; i++) EXPECT_EQUAL(fifo.read(), i);
+  EXPECT_EQUAL(fifo.empty(), true);
+
+  // Producer + Consumer Thread: blocking write() / read() keep all elements
+  // in order, FIFO never exceeds its depth
+  const int N = 200000, DEPTH = 4;
+  printf("    - threaded write() / read() (%d elements)\n", N);
+  hls::stream<int> channel("channel", DEPTH);
+  std::atomic<bool> overfull(false);
+  std::thread producer([&] {
+    for (int i = 0; i < N; i++) {
+      channel.write(i);
+      if (channel.size() > DEPTH) overfull = true;
+    }
+  });
+  int errors = 0;
+  for (int i = 0; i < N; i++) errors += (channel.read() != i);
+  producer.join();
+  EXPECT_EQUAL(errors, 0);
+  EXPECT_EQUAL(overfull.load(), false);
+  EXPECT_EQUAL(channel.empty(), true);
+
+  // write_nb() against a slower consumer: dropped elements never arrive,
+  // accepted ones arrive exactly once and in order (-1 = end)
+  printf("    - threaded write_nb() / read()\n");
+  std::atomic<int> accepted(0);
+  std::thread nb_producer([&] {
+    for (int i = 0; i < N; i++) accepted += channel.write_nb(i);
+    channel.write(-1);
+  });
+  int received = 0, last = -1, out_of_order = 0;
+  while ((value = channel.read()) != -1) {
+    out_of_order += (value <= last);
+    last = value;
+    received++;
+    if (received % 64 == 0) std::this_thread::yield();
+  }
+  nb_producer.join();
+  EXPECT_EQUAL(out_of_order, 0);
+  EXPECT_EQUAL(received, accepted.load());
+  EXPECT_EQUAL(channel.empty(), true);
+
+  return success;
+}
+#endif
+
 // =========================
 // = Main UnitTests Runner =
 // =========================
@@ -505,9 +1082,17 @@ bool do_unittests() {
   printf("Execute Unit Tests on FPGA Modules...\n");
 
   success &= test_MemoryController();
+  success &= test_MemoryControllerTopK();
   success &= test_WeightsCache();
+  success &= test_GroupedConvolution();
   success &= test_ImageCache();
   success &= test_OutputCache();
+  success &= test_PoolingCache();
+  success &= test_BypassAdd();
+  success &= test_ActivationMemoryPlan();
+#ifdef HLS_STREAM_SPSC
+  success &= test_HlsStreamSPSC();
+#endif
 
   return success;
 }
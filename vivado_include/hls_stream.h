@@ -30,6 +30,11 @@
 //////////////////////////////////////////////
 // C level simulation models for hls::stream
 //////////////////////////////////////////////
+#ifdef HLS_STREAM_SPSC
+// bounded lock-free single-producer / single-consumer model
+// (multi-threaded dataflow C-simulation with FIFO depths + deadlock check)
+#include "hls_stream_spsc.h"
+#else
 #include <queue>
 #include <iostream>
 #include <typeinfo>
@@ -212,5 +217,6 @@ class stream
 
 } // namespace hls
 
+#endif // HLS_STREAM_SPSC
 #endif // __cplusplus
 #endif  // X_HLS_STREAM_SIM_H
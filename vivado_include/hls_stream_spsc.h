@@ -0,0 +1,253 @@
+/*
+   Lock-free C simulation model of hls::stream (SqueezeNetOnFPGA)
+
+   Enabled by compiling with -DHLS_STREAM_SPSC (see hls_stream.h).
+   For multi-threaded dataflow C-simulation: one producer thread, one
+   consumer thread per stream (single-producer / single-consumer).
+
+   - bounded ring buffer with the FIFO depth of the hardware channel:
+     set_depth() or constructor argument (default HLS_STREAM_DEFAULT_DEPTH),
+     full() / write_nb() behave like the hardware FIFO
+   - blocking read() / write() spin HLS_STREAM_SPIN_COUNT times (only with
+     more than one CPU core), yield HLS_STREAM_YIELD_COUNT times, then block
+     (no lock traffic while data is flowing)
+   - deadlock detection: a read() / write() blocked for more than
+     HLS_STREAM_DEADLOCK_MS milliseconds (0 = never) reports the stream,
+     its depth and fill level and aborts (e.g. FIFO depth too small)
+*/
+
+#ifndef X_HLS_STREAM_SPSC_SIM_H
+#define X_HLS_STREAM_SPSC_SIM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <cxxabi.h>
+#endif
+
+#ifndef HLS_STREAM_DEFAULT_DEPTH
+#define HLS_STREAM_DEFAULT_DEPTH 2
+#endif
+#ifndef HLS_STREAM_SPIN_COUNT
+#define HLS_STREAM_SPIN_COUNT 4096
+#endif
+#ifndef HLS_STREAM_YIELD_COUNT
+#define HLS_STREAM_YIELD_COUNT 64
+#endif
+#ifndef HLS_STREAM_DEADLOCK_MS
+#define HLS_STREAM_DEADLOCK_MS 5000
+#endif
+
+namespace hls {
+
+template<typename __STREAM_T__>
+class stream
+{
+  protected:
+    std::string _name;
+    size_t _depth;                   // FIFO depth (max. number of elements)
+    size_t _mask;                    // ring buffer capacity - 1 (power of 2)
+    std::vector<__STREAM_T__> _data;
+    // read / write counters (never wrap in practice), own cache lines
+    alignas(64) std::atomic<size_t> _head;  // written by consumer only
+    alignas(64) std::atomic<size_t> _tail;  // written by producer only
+    alignas(64) std::atomic<bool> _waiting[2];  // blocked: [0] rd, [1] wr
+    std::mutex _mutex;
+    std::condition_variable _condition_var;
+
+  public:
+    /// Constructors
+    // Keep consistent with the synthesis model's constructors
+    stream() : _head(0), _tail(0) {
+        static unsigned _counter = 1;
+        std::stringstream ss;
+#ifndef _MSC_VER
+        char* _demangle_name = abi::__cxa_demangle(typeid(*this).name(), 0, 0, 0);
+        if (_demangle_name) {
+            _name = _demangle_name;
+            free(_demangle_name);
+        }
+        else {
+            _name = "hls_stream";
+        }
+#else
+        _name = typeid(*this).name();
+#endif
+
+        ss << _counter++;
+        _name += "." + ss.str();
+        set_depth(HLS_STREAM_DEFAULT_DEPTH);
+    }
+
+    stream(const std::string name, size_t depth = HLS_STREAM_DEFAULT_DEPTH)
+        : _name(name), _head(0), _tail(0) {
+        set_depth(depth);
+    }
+
+    /// FIFO depth (as #pragma HLS STREAM depth=...), only while empty
+    void set_depth(size_t depth) {
+        if (depth < 1) depth = 1;
+        size_t capacity = 1;
+        while (capacity < depth) capacity *= 2;
+        _depth = depth;
+        _mask = capacity - 1;
+        _data.assign(capacity, __STREAM_T__());
+        _head.store(0);
+        _tail.store(0);
+        _waiting[0].store(false);
+        _waiting[1].store(false);
+    }
+
+    size_t depth() const { return _depth; }
+
+  /// Make copy constructor and assignment operator private
+  private:
+    stream(const stream< __STREAM_T__ >& chn);
+    stream& operator = (const stream< __STREAM_T__ >& chn);
+
+  public:
+    /// Overload >> and << operators to implement read() and write()
+    void operator >> (__STREAM_T__& rdata) {
+        read(rdata);
+    }
+
+    void operator << (const __STREAM_T__& wdata) {
+        write(wdata);
+    }
+
+  public:
+    /// Destructor
+    /// Check status of the queue
+    virtual ~stream() {
+        if (!empty())
+        {
+            std::cout << "WARNING: Hls::stream '"
+                      << _name
+                      << "' contains leftover data,"
+                      << " which may result in RTL simulation hanging."
+                      << std::endl;
+        }
+    }
+
+    /// Status of the queue (as seen by the calling side)
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) ==
+               _tail.load(std::memory_order_acquire);
+    }
+
+    bool full() const {
+        return _tail.load(std::memory_order_acquire) -
+                   _head.load(std::memory_order_acquire) >= _depth;
+    }
+
+    /// Blocking read
+    void read(__STREAM_T__& head) {
+        head = read();
+    }
+
+    __STREAM_T__ read() {
+        if (empty()) wait_until(false);
+        size_t head = _head.load(std::memory_order_relaxed);
+        __STREAM_T__ elem = _data[head & _mask];
+        _head.store(head + 1, std::memory_order_seq_cst);
+        wake(true);
+        return elem;
+    }
+
+    /// Blocking write
+    void write(const __STREAM_T__& tail) {
+        if (full()) wait_until(true);
+        size_t t = _tail.load(std::memory_order_relaxed);
+        _data[t & _mask] = tail;
+        _tail.store(t + 1, std::memory_order_seq_cst);
+        wake(false);
+    }
+
+    /// Nonblocking read
+    bool read_nb(__STREAM_T__& head) {
+        if (empty()) {
+            head = __STREAM_T__();
+            return false;
+        }
+        head = read();
+        return true;
+    }
+
+    /// Nonblocking write (element is dropped if FIFO is full, as in HW)
+    bool write_nb(const __STREAM_T__& tail) {
+        if (full()) return false;
+        write(tail);
+        return true;
+    }
+
+    /// Fifo size
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) -
+               _head.load(std::memory_order_acquire);
+    }
+
+  private:
+    // Wait until not empty (writer == false) or not full (writer == true):
+    // spin first (other side runs on another core), then yield, then block
+    // on the condition variable
+    void wait_until(bool writer) {
+        static const bool multicore = std::thread::hardware_concurrency() > 1;
+        for (int i = 0; multicore && i < HLS_STREAM_SPIN_COUNT; i++) {
+            if (writer ? !full() : !empty()) return;
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+        for (int i = 0; i < HLS_STREAM_YIELD_COUNT; i++) {
+            if (writer ? !full() : !empty()) return;
+            std::this_thread::yield();
+        }
+
+        typedef std::chrono::steady_clock clock;
+        clock::time_point start = clock::now();
+        std::unique_lock<std::mutex> ul(_mutex);
+        while (true) {
+            // (seq_cst: either we see the other side's update, or it sees
+            //  _waiting and notifies; timeout only as safety net)
+            _waiting[writer].store(true, std::memory_order_seq_cst);
+            if (writer ? !full() : !empty()) break;
+            _condition_var.wait_for(ul, std::chrono::milliseconds(1));
+            long blocked_ms = std::chrono::duration_cast<
+                std::chrono::milliseconds>(clock::now() - start).count();
+            if (HLS_STREAM_DEADLOCK_MS > 0 &&
+                blocked_ms > HLS_STREAM_DEADLOCK_MS) {
+                std::cerr << "ERROR: Hls::stream '" << _name << "' "
+                          << (writer ? "write() blocked (full" :
+                                       "read() blocked (empty")
+                          << ", depth " << _depth << ", " << size()
+                          << " elements) for " << blocked_ms
+                          << " ms: FIFO deadlock?" << std::endl;
+                abort();
+            }
+        }
+        _waiting[writer].store(false, std::memory_order_relaxed);
+    }
+
+    // Wake blocked writer (writer == true) or reader (only if blocked)
+    void wake(bool writer) {
+        if (_waiting[writer].load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lg(_mutex);
+            _condition_var.notify_all();
+        }
+    }
+};
+
+} // namespace hls
+
+#endif  // X_HLS_STREAM_SPSC_SIM_H
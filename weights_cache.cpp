@@ -17,17 +17,19 @@
 // =================
 WeightsCache::WeightsCache() {
 //#pragma HLS ARRAY_RESHAPE variable=BRAM block factor=9 dim=1
+// (factor = WCACHE_RESHAPE_FACTOR in fpga_top.hpp)
 #pragma HLS ARRAY_RESHAPE variable=BRAM cyclic factor=2 dim=1
 };
 
 void WeightsCache::loadFromDRAM(MemoryController *DRAM) {
   LOG("WeightsCache: loadFromDRAM (total %d weights, %d biases)\n",
-      (int)(ch_in * ch_out * weights_per_filter), (int)ch_out);
+      (int)(ch_in * ch_out_per_group * weights_per_filter), (int)ch_out);
   LOG_LEVEL_INCR;
   LOG_LEVEL_INCR;
 
 // Load Filter Coefficients
-  weightaddr_t num_weights = ch_in * ch_out * weights_per_filter;
+  // (grouped conv: each input channel only has filters for its group)
+  weightaddr_t num_weights = ch_in * ch_out_per_group * weights_per_filter;
   assert(num_weights <= MAX_WEIGHTS_PER_LAYER && "Loading too many Weights!");
 L_WCACHE_LOAD_WEIGHTS:
   for (weightaddr_t addr = 0; addr < num_weights; addr++) {
@@ -62,17 +64,20 @@ void WeightsCache::setLayerConfig(layer_t &layer) {
   kernel = layer.kernel;
   ch_in = layer.channels_in;
   ch_out = layer.channels_out;
+  ch_out_per_group = layer.channels_out / layer.groups;
   weights_per_filter = (kernel == 3) ? 9 : 1;
   write_addr = 0;
   LOG("WeightsCache: setLayerConfig\n");
   LOG(" - kernel          = %d\n", (int)kernel);
   LOG(" - ch_in           = %d\n", (int)ch_in);
   LOG(" - ch_out          = %d\n", (int)ch_out);
+  LOG(" - co_per_group    = %d\n", (int)ch_out_per_group);
   LOG(" - w_per_filter    = %d\n", (int)weights_per_filter);
 }
 
 void WeightsCache::setInputChannel(channel_t ci) {
-  ci_offset = ci * ch_out * weights_per_filter;
+  // (ci = ch_in selects the biases, which are stored behind all filters)
+  ci_offset = ci * ch_out_per_group * weights_per_filter;
   LOG("WeightsCache: setInputChannel(%d), ci_offset = %d Elements, @%luB\n",
       (int)ci, (int)ci_offset, (int)ci_offset * sizeof(data_t));
 }
@@ -82,19 +87,24 @@ data_t WeightsCache::getWeight(const weightaddr_t addr) {
   return BRAM[addr];
 }
 
+// Compile-time KERNEL (dispatched once per layer in fpga_top): 3x3 reads
+// the 9 consecutive filter weights, 1x1 reads only the center weight
+template <int KERNEL>
 void WeightsCache::getNineWeights(channel_t co, data_t wbuffer[9]) {
-  weightaddr_t addr = ci_offset + co * weights_per_filter;
+  weightaddr_t addr = ci_offset + co * (KERNEL * KERNEL);
   LOG("WeightsCache: getNineWeights( co=%-2d ) from WCache[%3d]+\n", (int)co,
       (int)addr);
-  data_t weight_0 = getWeight(addr);
   L_getNineWeights:
   for (int i = 0; i < 9; i++) {
 #pragma HLS unroll
-	  data_t weight_i = getWeight(addr + i);
-	  data_t fetched = (kernel == 3) ? (weight_i) : (i==4 ? weight_0 : 0.0f);
-	  wbuffer[i] = fetched;
+	  if (KERNEL == 3)
+	    wbuffer[i] = getWeight(addr + i);
+	  else
+	    wbuffer[i] = (i == 4) ? getWeight(addr) : 0.0f;
   }
 }
+template void WeightsCache::getNineWeights<1>(channel_t co, data_t wbuffer[9]);
+template void WeightsCache::getNineWeights<3>(channel_t co, data_t wbuffer[9]);
 
 data_t WeightsCache::getOneWeight(channel_t co) {
 #pragma HLS inline
@@ -27,6 +27,7 @@ class WeightsCache {
   void addWeight(data_t weight);
   void loadFromDRAM(MemoryController *DRAM);
   void setInputChannel(channel_t ci);
+  template <int KERNEL>  // (1 or 3, 1x1: center weight, others 0)
   void getNineWeights(channel_t co, data_t wbuffer[9]);
   data_t getOneWeight(channel_t co);
 
@@ -37,6 +38,7 @@ class WeightsCache {
   kernel_t kernel;
   channel_t ch_out;
   channel_t ch_in;
+  channel_t ch_out_per_group;
   weightaddr_t ci_offset;
   numfilterelems_t weights_per_filter;
 };